@@ -0,0 +1,155 @@
+#include "AntiderivativeTanh.h"
+
+/*
+   fastTanh(u) = u / 28 + sum C 2u / (u^2 + K), the partial fractions of the FastMathPrecise rational.
+   The last pole is tanh's own first one, at u = i pi / 2.
+*/
+static const float K[3] = { 8.773919298e+01f, 2.229340591e+01f, 2.467401109e+00f };
+static const float C[3] = { 2.718336884e+00f, 1.022734519e+00f, 1.000000025e+00f };
+static const float SQRT_K[3] = { 9.366920144e+00f, 4.721589342e+00f, 1.570796329e+00f };
+static const float INV_K[3] = { 1.139741507e-02f, 4.485631330e-02f, 4.052847331e-01f };
+static const float INV_SQRT_K[3] = { 1.067586768e-01f, 2.117930908e-01f, 6.366197712e-01f };
+
+// atanh(z) / z from its series in z^2, to float precision for |z| < 1/3
+static inline float atanhOverX(float z2) {
+  return 1 + z2 * (1 / 3.0f + z2 * (1 / 5.0f + z2 * (1 / 7.0f + z2 * (1 / 9.0f + z2 * (1 / 11.0f + z2 * (1 / 13.0f))))));
+}
+
+// atan(w) / w - 1
+static inline float atanOverXMinusOne(float w) {
+  float w2 = w * w;
+  if (w2 < 0.16f) {
+    return w2 * (-1 / 3.0f + w2 * (1 / 5.0f + w2 * (-1 / 7.0f + w2 * (1 / 9.0f + w2 * (-1 / 11.0f + w2 * (1 / 13.0f))))));
+  }
+  return fastAtan(w) / w - 1;
+}
+
+/**
+   ln(1 + u^2 / k), the part of F1 the pole contributes, as 2 atanh(u^2 / (2k + u^2)) while that is small.
+*/
+static inline float poleLog(float u, int p) {
+  float u2 = u * u;
+  float z = u2 / (2 * K[p] + u2);
+  if (z < 1 / 3.0f) return 2 * z * atanhOverX(z * z);
+  return fastLog<FastMathPrecise>(1 + u2 * INV_K[p]);
+}
+
+/**
+   (ln(k + b^2) - ln(k + a^2)) / (b - a). The log difference is 2 atanh(z) with
+   z = (b - a)(b + a) / (2k + a^2 + b^2), so b - a divides out of the series exactly. z only gets past 1/3
+   with a and b well apart, the plain difference takes over there.
+*/
+static inline float poleLogDifference(float a, float b, int p) {
+  float sum = a + b;
+  float inv = 1 / (2 * K[p] + a * a + b * b);
+  float z = (b - a) * sum * inv;
+  float z2 = z * z;
+  if (z2 < 1 / 9.0f) return 2 * sum * inv * atanhOverX(z2);
+  return fastLog<FastMathPrecise>((K[p] + b * b) / (K[p] + a * a)) / (b - a);
+}
+
+// ln(1 + u^2 / k) for every pole
+static inline void antiderivativeLogs(float u, float *ln) {
+#pragma GCC unroll 3
+  for (int p = 0; p < 3; ++p) ln[p] = poleLog(u, p);
+}
+
+void AntiderivativeTanh::setOrder(int order) {
+  this->order = order < 2 ? 1 : 2;
+  x1 = x2 = 0;
+  lnX1[0] = lnX1[1] = lnX1[2] = 0;
+  mean1 = 0;
+}
+
+/**
+   (F1(b) - F1(a)) / (b - a), with one division per pole and no cancellation however close a and b are.
+*/
+float AntiderivativeTanh::mean(float a, float b) {
+  float y = (a + b) * (1 / 56.0f);
+#pragma GCC unroll 3
+  for (int p = 0; p < 3; ++p) y += C[p] * poleLogDifference(a, b, p);
+  return y;
+}
+
+/**
+   (F2(b) - F2(a)) / (b - a) with F2 = u^3 / 168 + sum C (u ln(1 + u^2 / k) - 2u + 2 sqrt(k) atan(u / sqrt(k))),
+   which leaves out the constant each log term of F1 has against ln(u^2 + k). Per pole that is
+      ln(1 + a^2 / k) + b (ln(k + b^2) - ln(k + a^2)) / (b - a) + 2 (k (atan(w) / w - 1) - a b) / (k + a b)
+   with w = (b - a) sqrt(k) / (k + a b) the tangent of the arctangent difference. That goes through the
+   roof as k + a b drops to zero and flips branch below it, but a b < -k / 2 only happens with a and b at
+   least sqrt(2 k) apart, where the plain arctangent difference is fine.
+*/
+float AntiderivativeTanh::antiderivativeMean(float a, float b, const float *lnA) {
+  float ab = a * b;
+  float y = (a * a + ab + b * b) * (1 / 168.0f);
+#pragma GCC unroll 3
+  for (int p = 0; p < 3; ++p) {
+    float k = K[p];
+    float term = lnA[p] + b * poleLogDifference(a, b, p);
+
+    float kab = k + ab;
+    if (kab > 0.5f * k) {
+      float invKab = 1 / kab;
+      float w = (b - a) * SQRT_K[p] * invKab;
+      term += 2 * (k * atanOverXMinusOne(w) - ab) * invKab;
+    } else {
+      term += 2 * SQRT_K[p] * (fastAtan(b * INV_SQRT_K[p]) - fastAtan(a * INV_SQRT_K[p])) / (b - a) - 2;
+    }
+    y += C[p] * term;
+  }
+  return y;
+}
+
+void AntiderivativeTanh::process(float *data, int n) {
+  // copy from class state
+  float x1 = this->x1;
+
+  if (order == 1) {
+    for (int i = 0; i < n; ++i) {
+      float x0 = data[i];
+      data[i] = mean(x1, x0);
+      x1 = x0;
+    }
+    this->x1 = x1;
+    return;
+  }
+
+  float x2 = this->x2;
+  float mean1 = this->mean1;
+  float lnX1[3], lnX0[3];
+  for (int p = 0; p < 3; ++p) lnX1[p] = this->lnX1[p];
+
+  for (int i = 0; i < n; ++i) {
+    float x0 = data[i];
+    antiderivativeLogs(x0, lnX0);
+    float mean0 = antiderivativeMean(x1, x0, lnX1);
+
+    float d = x0 - x2;
+    if (d * d >= ADAA_TOLERANCE * ADAA_TOLERANCE) {
+      data[i] = 2 * (mean0 - mean1) / d;
+    } else {
+      // x[n] and x[n - 2] as one point, the triangle collapses to the segment from there to x[n - 1]
+      float xm = (x0 + x2) * 0.5f;
+      float dm = x1 - xm;
+      if (dm * dm >= ADAA_TOLERANCE * ADAA_TOLERANCE) {
+        float lnXm[3];
+        antiderivativeLogs(xm, lnXm);
+        float f1 = xm * xm * (1 / 56.0f) + C[0] * lnXm[0] + C[1] * lnXm[1] + C[2] * lnXm[2];
+        data[i] = 2 * (antiderivativeMean(xm, x1, lnXm) - f1) / dm;
+      } else {
+        data[i] = fastTanh<FastMathPrecise>((x0 + x1 + x2) * (1 / 3.0f));
+      }
+    }
+
+    x2 = x1;
+    x1 = x0;
+    mean1 = mean0;
+    for (int p = 0; p < 3; ++p) lnX1[p] = lnX0[p];
+  }
+
+  // copy back to class state
+  this->x1 = x1;
+  this->x2 = x2;
+  this->mean1 = mean1;
+  for (int p = 0; p < 3; ++p) this->lnX1[p] = lnX1[p];
+}
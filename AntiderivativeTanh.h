@@ -0,0 +1,63 @@
+#ifndef _ANTIDERIVATIVE_TANH_H
+#define _ANTIDERIVATIVE_TANH_H
+
+#include <Arduino.h>
+
+#include "FastMath.h"
+
+// second order falls back to a lower order formula when the samples it divides by are closer than this
+#ifndef ADAA_TOLERANCE
+#define ADAA_TOLERANCE 3e-2f
+#endif
+
+/*
+   Antiderivative antialiasing (ADAA) for fastTanh().
+
+   Instead of f(x[n]), first order outputs the mean of f along the straight line from x[n - 1] to x[n],
+   (F1(x[n]) - F1(x[n - 1])) / (x[n] - x[n - 1]) with F1 the antiderivative of f. Second order outputs the
+   mean over the triangle x[n - 2], x[n - 1], x[n], twice the second divided difference of the second
+   antiderivative F2. Averaging the continuous shaper output before it is sampled keeps most of what it
+   makes above Nyquist from folding back, for a delay of half (first order) or one (second order) sample
+   and some droop towards Nyquist.
+
+   fastTanh() is the rational u P(u^2) / Q(u^2). Split into partial fractions over the three roots -k of Q
+   it is u / 28 + sum c 2u / (u^2 + k), so F1 = u^2 / 56 + sum c ln(1 + u^2 / k), and F2 is closed form as
+   well. Computed as written, the divided differences cancel catastrophically when consecutive samples are
+   close. Here the log differences are taken analytically instead,
+      ln(k + u1^2) - ln(k + u0^2) = 2 atanh(z), z = (u1 - u0)(u1 + u0) / (2k + u0^2 + u1^2)
+   and atanh(z) / z is a series in z^2, so u1 - u0 divides out exactly and there is one division per pole.
+   The arctangent difference in F2 is handled the same way. First order has no ill-conditioned case left. Second order still
+   subtracts the means over two neighbouring segments and divides by x[n] - x[n - 2], so below
+   ADAA_TOLERANCE it uses fastTanh() of the triangle's centroid instead.
+*/
+class AntiderivativeTanh {
+  public:
+    AntiderivativeTanh() {
+      setOrder(1);
+    }
+
+    // 1 or 2, clears the history
+    void setOrder(int order);
+    int getOrder(void) const {
+      return order;
+    }
+
+    // n samples in place
+    void process(float *data, int n);
+
+    // the mean of fastTanh() over [a, b], first order ADAA on its own
+    static float mean(float a, float b);
+
+  private:
+    // the mean of F1 over [a, b], less a constant, with F1 at a passed in
+    static float antiderivativeMean(float a, float b, const float *lnA);
+
+    int order;
+
+    // previous inputs, newest first, and the mean of F1 between them
+    float x1, x2;
+    float lnX1[3];
+    float mean1;
+};
+
+#endif /* _ANTIDERIVATIVE_TANH_H */
@@ -0,0 +1,33 @@
+#include "AudioConvertFloat.h"
+
+void AudioConvertIntToFloat::update(void) {
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    audio_block_t *inBlock = receiveReadOnly(c);
+    if (inBlock == NULL) continue;
+
+    audio_block_float_t *outBlock = allocateFloat();
+    if (outBlock != NULL) {
+      convertToFloat(inBlock->data, outBlock->data);
+      transmitFloat(outBlock, c);
+      releaseFloat(outBlock);
+    }
+
+    release(inBlock);
+  }
+}
+
+void AudioConvertFloatToInt::update(void) {
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    audio_block_float_t *inBlock = receiveReadOnlyFloat(c);
+    if (inBlock == NULL) continue;
+
+    audio_block_t *outBlock = allocate();
+    if (outBlock != NULL) {
+      convertToInt(inBlock->data, outBlock->data);
+      transmit(outBlock, c);
+      release(outBlock);
+    }
+
+    releaseFloat(inBlock);
+  }
+}
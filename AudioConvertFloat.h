@@ -0,0 +1,39 @@
+#ifndef _AUDIO_CONVERT_FLOAT_H
+#define _AUDIO_CONVERT_FLOAT_H
+
+#include <Arduino.h>
+#include <AudioStream.h>
+
+#include "AudioStreamFloat.h"
+
+/*
+   Entry and exit points of a float chain, e.g.
+     audioInput -> AudioConvertIntToFloat -> effects... -> AudioConvertFloatToInt -> audioOutput
+
+   Both convert NUM_CHANNELS channels, input n to output n.
+*/
+class AudioConvertIntToFloat : public AudioStreamFloat
+{
+  public:
+    AudioConvertIntToFloat() : AudioStreamFloat(NUM_CHANNELS, inputQueueArray, 0, NULL) {
+      // any extra initialization
+    }
+    virtual void update(void);
+
+  private:
+    audio_block_t *inputQueueArray[NUM_CHANNELS];
+};
+
+class AudioConvertFloatToInt : public AudioStreamFloat
+{
+  public:
+    AudioConvertFloatToInt() : AudioStreamFloat(0, NULL, NUM_CHANNELS, inputQueueArrayFloat) {
+      // any extra initialization
+    }
+    virtual void update(void);
+
+  private:
+    audio_block_float_t *inputQueueArrayFloat[NUM_CHANNELS];
+};
+
+#endif /* _AUDIO_CONVERT_FLOAT_H */
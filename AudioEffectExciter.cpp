@@ -1,4 +1,5 @@
 #include "AudioEffectExciter.h"
+#include "CoefficientDesign.h"
 #include "FastMath.h"
 
 void AudioEffectExciter::init(float sampleRate) {
@@ -12,80 +13,81 @@ void AudioEffectExciter::init(float sampleRate) {
 }
 
 void AudioEffectExciter::update(void) {
-  // work memory
-  audio_block_t *inBlock;
-  audio_block_t *outBlock;
+  uint32_t profileStart = profiler.start();
 
-  inBlock = receiveReadOnly();
-  outBlock = allocate();
+  processBlock();
 
-  if (inBlock == NULL || outBlock == NULL) return;
+  profiler.stop(profileStart);
+}
 
+void AudioEffectExciter::process(float **data) {
   float spl, s;
 
+  // pick up any new settings at the block boundary
+  const Params &p = mailbox.read();
+
   // get class state variables into the local stack for performance
-  float fooPlusOne = this->fooPlusOne;
-  float foo = this->foo;
-  float a0 = this->a0;
-  float b1 = this->b1;
-  float clipBoost = this->clipBoost;
-  float mixBack = this->mixBack;
-  float tmpONE = this->tmpONE;
-  float tmpTWO = this->tmpTWO;
-
-  // do the exciting stuff
+  float fooPlusOne = p.fooPlusOne;
+  float foo = p.foo;
+  float a0 = p.a0;
+  float b1 = p.b1;
+  float clipBoost = p.clipBoost;
+  float mixBack = p.mixBack;
+
+  float *d[NUM_CHANNELS];
+  float tmpONE[NUM_CHANNELS], tmpTWO[NUM_CHANNELS];
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    d[c] = data[c];
+    tmpONE[c] = this->tmpONE[c];
+    tmpTWO[c] = this->tmpTWO[c];
+  }
+
+  // do the exciting stuff, all channels of a sample together
   for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
-    spl = (float)inBlock->data[i] * INT_TO_FLOAT;
-    
-    s = spl;
-    s -= tmpONE = a0 * s - b1 * tmpONE + C_DENORM;
-    s = min(max(s * clipBoost, -1), 1);
+    for (int c = 0; c < NUM_CHANNELS; ++c) {
+      spl = d[c][i];
 
-    s = fooPlusOne * s / (1 + foo * fastAbs(spl));
-    s -= tmpTWO = a0 * s - b1 * tmpTWO + C_DENORM;
+      s = spl;
+      s -= tmpONE[c] = a0 * s - b1 * tmpONE[c] + C_DENORM;
+      s = min(max(s * clipBoost, -1), 1);
 
-    spl += s * mixBack;
+      s = fooPlusOne * s / (1 + foo * fastAbs(spl));
+      s -= tmpTWO[c] = a0 * s - b1 * tmpTWO[c] + C_DENORM;
 
-    outBlock->data[i] = (int)(spl * FLOAT_TO_INT);
+      spl += s * mixBack;
+
+      d[c][i] = spl;
+    }
   }
 
   // copy temp variables back into class state
-  this->tmpONE = tmpONE;
-  this->tmpTWO = tmpTWO;
-
-  // send the block and release the memory
-  transmit(outBlock);
-
-  // need to also release the input block because the library uses reference counting...
-  release(inBlock);
-  release(outBlock);
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    this->tmpONE[c] = tmpONE[c];
+    this->tmpTWO[c] = tmpTWO[c];
+  }
 }
 
 void AudioEffectExciter::setClipBoostDb(float clipBoostDb) {
-  __disable_irq();
-  clipBoost = fastExp(clipBoostDb / C_AMP_DB);
-  __enable_irq();
+  params.clipBoost = designExp(clipBoostDb / C_AMP_DB);
+  mailbox.publish(params);
 }
 
 void AudioEffectExciter::setMixBackDb(float mixBackDb) {
-  __disable_irq();
-  mixBack = fastExp(mixBackDb / C_AMP_DB);
-  __enable_irq();
+  params.mixBack = designExp(mixBackDb / C_AMP_DB);
+  mailbox.publish(params);
 }
 
 void AudioEffectExciter::setHarmonicsPercent(float harmonicsPercent) {
-  __disable_irq();
-  hdistr = min(harmonicsPercent / 100, .9);
-  foo = 2 * hdistr / (1 - hdistr);
-  fooPlusOne = foo + 1;
-  __enable_irq();
+  hdistr = min(harmonicsPercent / 100, .9f);
+  params.foo = 2 * hdistr / (1 - hdistr);
+  params.fooPlusOne = params.foo + 1;
+  mailbox.publish(params);
 }
 
 void AudioEffectExciter::setFrequency(float frequency) {
-  __disable_irq();
   freq = min(frequency, sampleRate);
-  x = fastExp(-2.0 * PI * freq / sampleRate);
-  a0 = 1.0 - x;
-  b1 = -x;
-  __enable_irq();
+  x = designPoleCoef(freq, sampleRate);
+  params.a0 = 1 - x;
+  params.b1 = -x;
+  mailbox.publish(params);
 }
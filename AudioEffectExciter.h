@@ -3,15 +3,26 @@
 
 #include <Arduino.h>
 #include <AudioStream.h>
+#include "AudioStreamFloat.h"
+#include "EffectProfiler.h"
+#include "ParameterMailbox.h"
 
-class AudioEffectExciter : public AudioStream
+class AudioEffectExciter : public AudioStreamFloat
 {
   public:
-    AudioEffectExciter() : AudioStream(1, inputQueueArray) {
+    AudioEffectExciter() : AudioStreamFloat(NUM_CHANNELS, inputQueueArray, NUM_CHANNELS, inputQueueArrayFloat) {
       // any extra initialization
     }
     void init(float sampleRate);
     virtual void update(void);
+    virtual void process(float **data);
+
+    void getProfile(EffectProfile &profile) {
+      profiler.snapshot(profile);
+    }
+    void resetProfile(void) {
+      profiler.reset();
+    }
 
     void setClipBoostDb(float clipBoostDb);
     void setMixBackDb(float mixBackDb);
@@ -19,19 +30,30 @@ class AudioEffectExciter : public AudioStream
     void setFrequency(float frequency);
 
   private:
-    audio_block_t *inputQueueArray[1];
+    audio_block_t *inputQueueArray[NUM_CHANNELS];
+    audio_block_float_t *inputQueueArrayFloat[NUM_CHANNELS];
+    EffectProfiler profiler;
 
     float sampleRate;
 
-    float clipBoost;
-    float mixBack;
     float hdistr;
-    float foo, fooPlusOne;
     float freq;
     float x;
-    float a0;
-    float b1;
-    float tmpONE, tmpTWO;
+
+    // everything update() needs, published as one set by the setters
+    struct Params {
+      float clipBoost;
+      float mixBack;
+      float foo, fooPlusOne;
+      float a0;
+      float b1;
+    };
+
+    Params params;
+    ParameterMailbox<Params> mailbox;
+
+    // per channel filter state
+    float tmpONE[NUM_CHANNELS] = {}, tmpTWO[NUM_CHANNELS] = {};
 };
 
 #endif /* _AUDIO_EFFECT_EXCITER_H */
@@ -1,8 +1,17 @@
 #include "AudioEffectFetCompressor.h"
+#include "CoefficientDesign.h"
 
 void AudioEffectFetCompressor::init(float sampleRate) {
   this->sampleRate = sampleRate;
 
+#if FIXED_POINT_DSP
+  for (int c = 0; c < NUM_CHANNELS; ++c) fixedGain[c] = -1;
+#endif
+
+  params.ratatcoef = designTimeCoef(0.00001, sampleRate);
+  params.ratrelcoef = designTimeCoef(0.5, sampleRate);
+  params.rmscoef = designTimeCoef(FET_RMS_TIME, sampleRate);
+
   // set defaults
   setThresholdDb(-6.0);
   setRatioMode(CleanAll);
@@ -10,172 +19,387 @@ void AudioEffectFetCompressor::init(float sampleRate) {
   setAttackTimeUs(20);
   setReleaseTimeMs(50);
   setMix(100.0);
-  ratatcoef = fastExp(-1 / (0.00001 * sampleRate));
-  ratrelcoef = fastExp(-1 / (0.5 * sampleRate));
 }
 
 void AudioEffectFetCompressor::update(void) {
+  uint32_t profileStart = profiler.start();
+
+  processBlock();
+
+  profiler.stop(profileStart);
+}
+
+void AudioEffectFetCompressor::process(float **data) {
+  // pick up any new settings at the block boundary
+  const Params &p = mailbox.read();
+  const int detectors = NUM_CHANNELS > 1 && p.linked ? 1 : NUM_CHANNELS;
+
+  // the detector listens to the key, normally the input itself. With lookahead the key is the peak of the
+  // samples still in the delay line and data comes out of the delay.
+  float lookaheadPeak[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+  float linkedKey[AUDIO_BLOCK_SAMPLES];
+  const float *key[NUM_CHANNELS];
+
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    meter.measureInput(c, data[c]);
+    key[c] = data[c];
 
-  // work memory
-  audio_block_t *inBlock;
-  audio_block_t *outBlock;
+    if (p.lookahead != lookahead[c].getLength()) lookahead[c].setLength(p.lookahead);
+    if (p.lookahead > 0) {
+      lookahead[c].process(data[c], lookaheadPeak[c]);
+      key[c] = lookaheadPeak[c];
+    }
+  }
+
+  // linked, only the first detector runs and every channel gets its gain
+  if (detectors < NUM_CHANNELS) EnvelopeFollower::linkKeys(key, linkedKey);
+
+  // the lookahead peak is already a level, don't average it
+  float level[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+  for (int c = 0; c < detectors; ++c) {
+    detector[c].setCoef(p.lookahead > 0 ? 0 : p.rmscoef);
+    detector[c].process(key[c], level[c], EnvelopeLogRms);
+  }
+
+  float gain[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+  computeGain(p, detectors, level, gain);
 
-  inBlock = receiveReadOnly();
-  outBlock = allocate();
+  float makeupMix = p.makeupv * p.mix;
+  float oneMinusMix = p.oneMinusMix;
 
-  if (inBlock == NULL || outBlock == NULL) return;
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    const float *g = gain[c < detectors ? c : 0];
+    float *d = data[c];
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) d[i] *= g[i] * makeupMix + oneMinusMix;
+
+    meter.measureGain(c, g);
+    meter.measureOutput(c, d);
+  }
+  meter.record();
+}
+
+void AudioEffectFetCompressor::computeGain(const Params &p, int detectors, float (*level)[AUDIO_BLOCK_SAMPLES],
+                                           float (*gain)[AUDIO_BLOCK_SAMPLES]) {
+  if (p.controlRate > 1) {
+    computeGainControlRate(p, detectors, level, gain);
+  } else {
+    computeGainPerSample(p, detectors, level, gain);
+  }
+
+  // linked channels follow the first so unlinking picks up without a jump
+  for (int c = detectors; c < NUM_CHANNELS; ++c) {
+    detector[c] = detector[0];
+    rundb[c] = rundb[0];
+    averatio[c] = averatio[0];
+    runratio[c] = runratio[0];
+    grv[c] = grv[0];
+  }
+}
+
+/**
+   The gain reduction in the log domain, every sample, turned into linear gains over the whole block at
+   the end.
+*/
+void AudioEffectFetCompressor::computeGainPerSample(const Params &p, int detectors,
+                                                    float (*level)[AUDIO_BLOCK_SAMPLES],
+                                                    float (*gain)[AUDIO_BLOCK_SAMPLES]) {
+  float capsc = p.capsc;
+  float cthreshLog = p.cthreshLog;
+  float atcoef = p.atcoef;
+  float ratatcoef = p.ratatcoef;
+  float relcoef = p.relcoef;
+  float ratrelcoef = p.ratrelcoef;
+  bool allin = p.allin;
+  float ratio = p.ratio;
 
   // copy from class state
-  float runave = this->runave;
-  float capsc = this->capsc;
-  float cthreshvRecip = this->cthreshvRecip;
-  float rundb = this->rundb;
-  float averatio = this->averatio;
-  float runratio = this->runratio;
-  float atcoef = this->atcoef;
-  float ratatcoef = this->ratatcoef;
-  float relcoef = this->relcoef;
-  float ratrelcoef = this->ratrelcoef;
-  float runmax = this->runmax;
-  float maxover = this->maxover;
-  float makeupv = this->makeupv;
-  float mix = this->mix;
-  float oneMinusMix = this->oneMinusMix;
-
-  // do the compressing
-  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+  float rundb[NUM_CHANNELS], averatio[NUM_CHANNELS], runratio[NUM_CHANNELS];
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    rundb[c] = this->rundb[c];
+    averatio[c] = this->averatio[c];
+    runratio[c] = this->runratio[c];
+  }
 
-    float spl = (float)inBlock->data[i] * INT_TO_FLOAT;
-    float ospl = spl;
-    float maxspl = spl * spl;
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+    for (int c = 0; c < detectors; ++c) {
+      float overdb = max(0, capsc * (level[c][i] + cthreshLog));
 
-    runave = maxspl + rmscoef * (runave - maxspl);
+      float dbDelta = rundb[c] - overdb;
+      if (dbDelta < -5) averatio[c] = 4;
 
-    float det = fastSqrt(max(0, runave));
-    float overdb = max(0, capsc * fastLog(det * cthreshvRecip));
+      float ratioDelta = runratio[c] - averatio[c];
 
-    float dbDelta = rundb - overdb;
-    if (dbDelta < -5) averatio = 4;
+      // If dbDelta is less than 0, that means that overdb is greater than rundb and we are in the attack phase. Otherwise, we are in the release phase.
+      if (dbDelta < 0.0f) {
+        rundb[c] = overdb + atcoef * dbDelta;
+        runratio[c] = averatio[c] + ratatcoef * ratioDelta;
+      } else {
+        rundb[c] = overdb + relcoef * dbDelta;
+        runratio[c] = averatio[c] + ratrelcoef * ratioDelta;
+      }
 
-    float ratioDelta = runratio - averatio;
+      overdb = rundb[c];
+      averatio[c] = runratio[c];
 
-    // If dbDelta is less than 0, that means that overdb is greater than rundb and we are in the attack phase. Otherwise, we are in the release phase.
-    if (dbDelta < 0.0f) {
-      rundb = overdb + atcoef * dbDelta;
-      runratio = averatio + ratatcoef * ratioDelta;
-    } else {
-      rundb = overdb + relcoef * dbDelta;
-      runratio = averatio + ratrelcoef * ratioDelta;
+      float cratio = allin ? 12 + averatio[c] : ratio;
+      float gr = -overdb * (cratio - 1) / cratio;
+      gain[c][i] = gr * DB_TO_LOG;
     }
+  }
 
-    overdb = rundb;
-    averatio = runratio;
+  // copy back to class state, the gain decays into the denormal range on a silent channel, flush it
+  for (int c = 0; c < detectors; ++c) {
+    fastExpBlock(gain[c], gain[c]);
 
-    float cratio = allin ? 12 + averatio : ratio;
-    float gr = -overdb * (cratio - 1) / cratio;
-    float grv = fastExp(gr * DB_TO_LOG);
+    this->rundb[c] = fastAbs(rundb[c]) < C_DENORM ? 0 : rundb[c];
+    this->averatio[c] = averatio[c];
+    this->runratio[c] = runratio[c];
+    this->grv[c] = gain[c][AUDIO_BLOCK_SAMPLES - 1];
+  }
+}
 
-    runmax = maxover + relcoef * (runmax - maxover);  // highest peak for setting att/rel decays in reltime
+/**
+   The detector still runs every sample. The log domain gain computer runs once per controlRate samples,
+   on the level at the last of them, with its smoothing coefficients raised to that power so it covers the
+   same time constants, and the gain is ramped linearly from the last control point to the new one.
+*/
+void AudioEffectFetCompressor::computeGainControlRate(const Params &p, int detectors,
+                                                      float (*level)[AUDIO_BLOCK_SAMPLES],
+                                                      float (*gain)[AUDIO_BLOCK_SAMPLES]) {
+  const int n = p.controlRate;
+  const float nRecip = 1.0f / n;
 
-    maxover = runmax;
-    spl *= grv * makeupv * mix;
-    spl += ospl * oneMinusMix;
+  float capsc = p.capsc;
+  float cthreshLog = p.cthreshLog;
+  float atcoef = p.atcoefN;
+  float ratatcoef = p.ratatcoefN;
+  float relcoef = p.relcoefN;
+  float ratrelcoef = p.ratrelcoefN;
+  bool allin = p.allin;
+  float ratio = p.ratio;
 
-    outBlock->data[i] = (int)(spl * FLOAT_TO_INT);
+  // copy from class state
+  float rundb[NUM_CHANNELS], averatio[NUM_CHANNELS], runratio[NUM_CHANNELS];
+  float grv[NUM_CHANNELS];
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    rundb[c] = this->rundb[c];
+    averatio[c] = this->averatio[c];
+    runratio[c] = this->runratio[c];
+    grv[c] = this->grv[c];
   }
 
-  // send the block and release the memory
-  transmit(outBlock);
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i += n) {
+    for (int c = 0; c < detectors; ++c) {
+      float overdb = max(0, capsc * (level[c][i + n - 1] + cthreshLog));
+
+      float dbDelta = rundb[c] - overdb;
+      if (dbDelta < -5) averatio[c] = 4;
+
+      float ratioDelta = runratio[c] - averatio[c];
+
+      if (dbDelta < 0.0f) {
+        rundb[c] = overdb + atcoef * dbDelta;
+        runratio[c] = averatio[c] + ratatcoef * ratioDelta;
+      } else {
+        rundb[c] = overdb + relcoef * dbDelta;
+        runratio[c] = averatio[c] + ratrelcoef * ratioDelta;
+      }
+
+      overdb = rundb[c];
+      averatio[c] = runratio[c];
+
+      float cratio = allin ? 12 + averatio[c] : ratio;
+      float gr = -overdb * (cratio - 1) / cratio;
+      float grvStep = (fastExp(gr * DB_TO_LOG) - grv[c]) * nRecip;
+
+      for (int j = i; j < i + n; ++j) {
+        grv[c] += grvStep;
+        gain[c][j] = grv[c];
+      }
+    }
+  }
 
   // copy back to class state
-  this->runave = runave;
-  this->rundb = rundb;
-  this->averatio = averatio;
-  this->runratio = runratio;
-  this->runmax = runmax;
-  this->maxover = maxover;
+  for (int c = 0; c < detectors; ++c) {
+    this->rundb[c] = fastAbs(rundb[c]) < C_DENORM ? 0 : rundb[c];
+    this->averatio[c] = averatio[c];
+    this->runratio[c] = runratio[c];
+    this->grv[c] = grv[c];
+  }
+}
+
+bool AudioEffectFetCompressor::isSettled(void) {
+  // the detector follows the lookahead peak then, it's only quiet once the delay line holds silence
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    if (rundb[c] != 0 || !detector[c].isSettled()) return false;
+  }
+  return true;
+}
 
-  // need to also release the input block because the library uses reference counting...
-  release(inBlock);
-  release(outBlock);
+#if FIXED_POINT_DSP
+/**
+   process() for int16 blocks. The detector's one pole runs in fixed point and the gain, makeup and mix
+   are one multiply per sample. The log domain gain computer between them is the float one. The lookahead
+   delay line is float, with lookahead on the block goes through process() instead.
+*/
+bool AudioEffectFetCompressor::processFixed(int16_t **data) {
+  // pick up any new settings at the block boundary
+  const Params &p = mailbox.read();
+  if (p.lookahead > 0) return false;
 
+  const int detectors = NUM_CHANNELS > 1 && p.linked ? 1 : NUM_CHANNELS;
+
+  int16_t linkedKey[AUDIO_BLOCK_SAMPLES];
+  const int16_t *key[NUM_CHANNELS];
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    meter.measureInput(c, data[c]);
+    key[c] = data[c];
+    // lookahead was just turned off, drop what process() left in the delay line
+    if (lookahead[c].getLength() != 0) lookahead[c].setLength(0);
+  }
+  if (detectors < NUM_CHANNELS) EnvelopeFollower::linkKeys(key, linkedKey);
+
+  float level[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+  for (int c = 0; c < detectors; ++c) {
+    detector[c].setCoef(p.rmscoef);
+    detector[c].processFixed(key[c], level[c], EnvelopeLogRms);
+  }
+
+  float gain[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+  computeGain(p, detectors, level, gain);
+
+  float makeupMix = p.makeupv * p.mix;
+  float oneMinusMix = p.oneMinusMix;
+
+  // the gain is linear between control points already, ramp it in integers across them
+  int rampShift = 0;
+  while ((1 << rampShift) < p.controlRate) ++rampShift;
+
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    const float *g = gain[c < detectors ? c : 0];
+    int16_t *d = data[c];
+    applyGainFixed(d, g, makeupMix, oneMinusMix, rampShift, fixedGain[c]);
+
+    meter.measureGain(c, g);
+    meter.measureOutput(c, d);
+  }
+  meter.record();
+  return true;
+}
+#endif
+
+void AudioEffectFetCompressor::setControlCoefs(void) {
+  params.atcoefN = params.relcoefN = params.ratatcoefN = params.ratrelcoefN = 1;
+  for (int i = 0; i < params.controlRate; ++i) {
+    params.atcoefN *= params.atcoef;
+    params.relcoefN *= params.relcoef;
+    params.ratatcoefN *= params.ratatcoef;
+    params.ratrelcoefN *= params.ratrelcoef;
+  }
 }
 
 void AudioEffectFetCompressor::setThresholdDb(float thresholdDb) {
-  __disable_irq();
   thresh = thresholdDb;
   setThresholdParams(softknee, thresh);
-  __enable_irq();
+  mailbox.publish(params);
 }
 
 void AudioEffectFetCompressor::setSoftKnee(bool softknee) {
-  __disable_irq();
   this->softknee = softknee;
   setThresholdParams(softknee, thresh);
-  __enable_irq();
+  mailbox.publish(params);
 }
 
 void AudioEffectFetCompressor::setThresholdParams(bool softknee, float thresh) {
   float cthresh = (softknee ? (thresh - 3) : thresh);
-  cthreshv = fastExp(cthresh * DB_TO_LOG);
-  cthreshvRecip = 1 / cthreshv;
+  cthreshv = designDbToGain(cthresh);
+  // ln(1 / cthreshv), added to the detector's log level
+  params.cthreshLog = -cthresh * DB_TO_LOG;
 }
 
 void AudioEffectFetCompressor::setRatioMode(RatioMode mode) {
-  __disable_irq();
   ratioMode = mode;
   int rpos = ratioMode;
-  capsc = LOG_TO_DB;
+  params.capsc = LOG_TO_DB;
   if (rpos > 4) {
     rpos -= 5;
   } else  {
-    capsc *= BLOWN_CAP_SCALAR;
+    params.capsc *= BLOWN_CAP_SCALAR;
   }
-  allin = false;
+  params.allin = false;
   switch (rpos) {
     case 0:
-      ratio = 4;
+      params.ratio = 4;
       break;
     case 1:
-      ratio = 8;
+      params.ratio = 8;
       break;
     case 2:
-      ratio = 12;
+      params.ratio = 12;
       break;
     case 3:
-      ratio = 20;
+      params.ratio = 20;
       break;
     case 4:
-      allin = true;
-      ratio = 20;
+      params.allin = true;
+      params.ratio = 20;
       break;
   }
-  __enable_irq();
+  mailbox.publish(params);
 }
 
 void AudioEffectFetCompressor::setGainDb(float gain) {
-  __disable_irq();
-  makeupv = fastExp((gain) * DB_TO_LOG);
-  __enable_irq();
+  params.makeupv = designDbToGain(gain);
+  mailbox.publish(params);
 }
 
 void AudioEffectFetCompressor::setAttackTimeUs(float uSec) {
-  __disable_irq();
   float attime = uSec / 1000000;
-  atcoef = fastExp(-1 / (attime * sampleRate));
-  __enable_irq();
+  params.atcoef = designTimeCoef(attime, sampleRate);
+  setControlCoefs();
+  mailbox.publish(params);
 }
 
 void AudioEffectFetCompressor::setReleaseTimeMs(float mSec) {
-  __disable_irq();
   float reltime = mSec / 1000;
-  relcoef = fastExp(-1 / (reltime * sampleRate));
-  __enable_irq();
+  params.relcoef = designTimeCoef(reltime, sampleRate);
+  setControlCoefs();
+  mailbox.publish(params);
 }
 
 void AudioEffectFetCompressor::setMix(float percent) {
-  __disable_irq();
-  mix = percent * 0.01;
-  oneMinusMix = 1 - mix;
-  __enable_irq();
+  params.mix = percent * 0.01f;
+  params.oneMinusMix = 1 - params.mix;
+  mailbox.publish(params);
+}
+
+/**
+   Run the gain computer every 1, 2, 4, 8 or 16 samples, other values are rounded down to one of those.
+   1 is the exact per-sample path.
+*/
+void AudioEffectFetCompressor::setControlRate(int samples) {
+  int rate = 1;
+  while (rate * 2 <= samples && rate * 2 <= FET_MAX_CONTROL_RATE) rate *= 2;
+  params.controlRate = rate;
+  setControlCoefs();
+  mailbox.publish(params);
+}
+
+/**
+   Delay the audio by 0.1 to 5 ms so the gain is already down when a transient comes out, 0 turns it off.
+   The delay is reported by getLatency(). The delay line is float, with FIXED_POINT_DSP the int16 path is
+   skipped and every block goes through process() while lookahead is on.
+*/
+void AudioEffectFetCompressor::setLookaheadMs(float ms) {
+  params.lookahead = LookaheadDelay::msToSamples(ms, sampleRate);
+  mailbox.publish(params);
+}
+
+/**
+   Drive every channel's gain from one detector following the loudest channel, so the stereo image
+   stays put when one side compresses. Off, each channel is compressed on its own.
+*/
+void AudioEffectFetCompressor::setLinked(bool linked) {
+  params.linked = linked;
+  mailbox.publish(params);
 }
@@ -3,20 +3,53 @@
 
 #include <Arduino.h>
 #include <AudioStream.h>
+#include "AudioStreamFloat.h"
+#include "DynamicsMeter.h"
+#include "EffectProfiler.h"
+#include "ParameterMailbox.h"
+#include "LookaheadDelay.h"
+#include "EnvelopeFollower.h"
 #include "FastMath.h"
+#include "FixedPoint.h"
+
+// 50us RMS detector, as in the 1175 this is modeled on
+#define FET_RMS_TIME 0.00005
+
+// gain computer runs every 1 (per sample) to FET_MAX_CONTROL_RATE samples, must divide AUDIO_BLOCK_SAMPLES
+#define FET_MAX_CONTROL_RATE 16
 
 enum RatioMode {
   BlownCap4, BlownCap8, BlownCap12, BlownCap20, BlownCapAll, Clean4, Clean8, Clean12, Clean20, CleanAll
 };
 
-class AudioEffectFetCompressor : public AudioStream
+class AudioEffectFetCompressor : public AudioStreamFloat
 {
   public:
-    AudioEffectFetCompressor() : AudioStream(1, inputQueueArray) {
+    AudioEffectFetCompressor() : AudioStreamFloat(NUM_CHANNELS, inputQueueArray, NUM_CHANNELS, inputQueueArrayFloat) {
       // any extra initialization
+      for (int c = 0; c < NUM_CHANNELS; ++c) grv[c] = 1.0f;
     }
     void init(float sampleRate);
     virtual void update(void);
+    virtual void process(float **data);
+#if FIXED_POINT_DSP
+    virtual bool processFixed(int16_t **data);
+#endif
+
+    void getProfile(EffectProfile &profile) {
+      profiler.snapshot(profile);
+    }
+    void resetProfile(void) {
+      profiler.reset();
+    }
+
+    // true once the gain reduction has fully released and the detectors have gone quiet
+    virtual bool isSettled(void);
+
+    // levels and gain reduction of the last block, safe to call from loop() while audio is running
+    void getLevels(DynamicsLevels &levels) {
+      meter.snapshot(levels);
+    }
 
     void setThresholdDb(float thresholdDb);
     void setRatioMode(RatioMode mode);
@@ -25,33 +58,77 @@ class AudioEffectFetCompressor : public AudioStream
     void setAttackTimeUs(float uSec);
     void setReleaseTimeMs(float mSec);
     void setMix(float percent);
+    void setControlRate(int samples);
+    void setLookaheadMs(float ms);
+    void setLinked(bool linked);
+
+    // added latency in samples, from the lookahead
+    int getLatency(void) {
+      return params.lookahead;
+    }
 
   private:
-    audio_block_t *inputQueueArray[1];
+    audio_block_t *inputQueueArray[NUM_CHANNELS];
+    audio_block_float_t *inputQueueArrayFloat[NUM_CHANNELS];
+    EffectProfiler profiler;
+    DynamicsMeter meter;
 
     float sampleRate;
 
     void setThresholdParams(bool softknee, float thresh);
+    void setControlCoefs(void);
 
     // from controls
     RatioMode ratioMode;
     bool softknee;
     float thresh;
+    float cthreshv;
+
+    // everything update() needs, published as one set by the setters
+    struct Params {
+      float ratio;
+      bool allin;
+      float capsc;
+      float cthreshLog;
+      float atcoef, relcoef;
+      float ratatcoef, ratrelcoef;
+      float makeupv;
+      float mix, oneMinusMix;
+      float rmscoef;
+
+      // gain computer rate, and the smoothing coefficients raised to that power
+      int controlRate = 1;
+      float atcoefN, relcoefN;
+      float ratatcoefN, ratrelcoefN;
+
+      // lookahead delay in samples, 0 is off
+      int lookahead = 0;
+
+      // one detector on the loudest channel, its gain applied to all of them
+      bool linked = false;
+    };
+
+    // the first detectors channels' linear gain for every sample from their detector's log level
+    void computeGain(const Params &p, int detectors, float (*level)[AUDIO_BLOCK_SAMPLES],
+                     float (*gain)[AUDIO_BLOCK_SAMPLES]);
+    void computeGainPerSample(const Params &p, int detectors, float (*level)[AUDIO_BLOCK_SAMPLES],
+                              float (*gain)[AUDIO_BLOCK_SAMPLES]);
+    void computeGainControlRate(const Params &p, int detectors, float (*level)[AUDIO_BLOCK_SAMPLES],
+                                float (*gain)[AUDIO_BLOCK_SAMPLES]);
+
+    Params params;
+    ParameterMailbox<Params> mailbox;
+    LookaheadDelay lookahead[NUM_CHANNELS];
 
-    float ratio;
-    float rundb;
-    float ratatcoef;
-    float ratrelcoef;
-    float atcoef;
-    float relcoef;
-    float mix, oneMinusMix;
-
-    float capsc;
-    bool allin;
-    float cthreshv, cthreshvRecip;
-    float makeupv;
-    float runave, rmscoef = 1, runmax, maxover;
-    float averatio, runratio;
+    // per channel detector and gain computer state
+    EnvelopeFollower detector[NUM_CHANNELS];
+#if FIXED_POINT_DSP
+    // the gain processFixed() applied last, its integer ramps start from there
+    int32_t fixedGain[NUM_CHANNELS];
+#endif
+    float rundb[NUM_CHANNELS] = {};
+    float averatio[NUM_CHANNELS] = {}, runratio[NUM_CHANNELS] = {};
+    float grv[NUM_CHANNELS];
 
 };
 
@@ -1,8 +1,13 @@
 #include "AudioEffectOpticalCompressor.h"
+#include "CoefficientDesign.h"
 
 void AudioEffectOpticalCompressor::init(float sampleRate) {
   this->sampleRate = sampleRate;
 
+#if FIXED_POINT_DSP
+  for (int c = 0; c < NUM_CHANNELS; ++c) fixedGain[c] = -1;
+#endif
+
   // defaults
   setThresholdDb(-3.0);
   setBias(70.0);
@@ -13,109 +18,188 @@ void AudioEffectOpticalCompressor::init(float sampleRate) {
 }
 
 void AudioEffectOpticalCompressor::update(void) {
+  uint32_t profileStart = profiler.start();
+
+  processBlock();
+
+  profiler.stop(profileStart);
+}
+
+void AudioEffectOpticalCompressor::process(float **data) {
+  // pick up any new settings at the block boundary
+  const Params &p = mailbox.read();
+  const int detectors = NUM_CHANNELS > 1 && p.linked ? 1 : NUM_CHANNELS;
+
+  // the detector listens to the key, normally the input itself. With lookahead the key is the peak of the
+  // samples still in the delay line and data comes out of the delay.
+  float lookaheadPeak[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+  float linkedKey[AUDIO_BLOCK_SAMPLES];
+  const float *key[NUM_CHANNELS];
+
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    meter.measureInput(c, data[c]);
+    key[c] = data[c];
+
+    if (p.lookahead != lookahead[c].getLength()) lookahead[c].setLength(p.lookahead);
+    if (p.lookahead > 0) {
+      lookahead[c].process(data[c], lookaheadPeak[c]);
+      key[c] = lookaheadPeak[c];
+    }
+  }
+
+  // linked, only the first detector runs and every channel gets its gain
+  if (detectors < NUM_CHANNELS) EnvelopeFollower::linkKeys(key, linkedKey);
 
-  // work memory
-  audio_block_t *inBlock;
-  audio_block_t *outBlock;
+  // the lookahead peak is already a level, don't average it
+  float level[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+  for (int c = 0; c < detectors; ++c) {
+    detector[c].setCoef(p.lookahead > 0 ? 0 : p.rmscoef);
+    detector[c].process(key[c], level[c], EnvelopeLogRms);
+  }
+
+  float gain[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+  computeGain(p, detectors, level, gain);
 
-  inBlock = receiveReadOnly();
-  outBlock = allocate();
+  float makeupv = p.makeupv;
 
-  if (inBlock == NULL || outBlock == NULL) return;
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    const float *g = gain[c < detectors ? c : 0];
+    float *d = data[c];
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) d[i] *= g[i] * makeupv;
+
+    meter.measureGain(c, g);
+    meter.measureOutput(c, d);
+  }
+  meter.record();
+}
+
+/**
+   The gain reduction in dB every sample, turned into linear gains over the whole block at the end
+*/
+void AudioEffectOpticalCompressor::computeGain(const Params &p, int detectors,
+                                               float (*level)[AUDIO_BLOCK_SAMPLES],
+                                               float (*gain)[AUDIO_BLOCK_SAMPLES]) {
+  float capsc = p.capsc;
+  float threshLog = p.threshLog;
+  float atcoef = p.atcoef;
+  float relcoef = p.relcoef;
+  float biasRecip = p.biasRecip;
 
   // copy in class state
-  float runave = this->runave;
-  float rmscoef = this->rmscoef;
-  float capsc = this->capsc;
-  float threshvRecip = this->threshvRecip;
-  float rundb = this->rundb;
-  float atcoef = this->atcoef;
-  float relcoef = this->relcoef;
-  float biasRecip = this->biasRecip;
-  float makeupv = this->makeupv;
-
-  // do the compressing
-  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+  float rundb[NUM_CHANNELS];
+  for (int c = 0; c < NUM_CHANNELS; ++c) rundb[c] = this->rundb[c];
 
-    float spl = (float)inBlock->data[i] * INT_TO_FLOAT;
-    float maxspl = spl * spl;
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+    for (int c = 0; c < detectors; ++c) {
+      float overdb = capsc * (level[c][i] + threshLog);
+      overdb = max(0, overdb);
 
-    runave = maxspl + rmscoef * (runave - maxspl);
+      float dbDelta = rundb[c] - overdb;
 
-    float det = fastSqrt(max(0, runave));
-    float overdb = capsc * fastLog(det * threshvRecip);
-    overdb = max(0, overdb);
+      rundb[c] = overdb;
+      // dbDelta will be negative if overdb is greater than rundb, so we're in the attack phase.  Otherwise, we're in the release phase.
+      rundb[c] += (dbDelta < 0.0f ? atcoef : relcoef) * dbDelta;
 
-    float dbDelta = rundb - overdb;
+      overdb = max(rundb[c], 0);
 
-    rundb = overdb;
-    // dbDelta will be negative if overdb is greater than rundb, so we're in the attack phase.  Otherwise, we're in the release phase.
-    rundb += (dbDelta < 0.0f ? atcoef : relcoef) * dbDelta;
+      float cratio = OPT_COMP_RATIO_MINUS_ONE * fastSqrt<FastMathFast>(overdb * biasRecip);
+      float gr = -overdb * cratio  / (cratio + 1);
+      gain[c][i] = gr * DB_TO_LOG;
+    }
+  }
 
-    overdb = max(rundb, 0);
+  for (int c = 0; c < detectors; ++c) fastExpBlock(gain[c], gain[c]);
 
-    float cratio = OPT_COMP_RATIO_MINUS_ONE * fastSqrt(overdb * biasRecip);
-    gr = -overdb * cratio  / (cratio + 1);
-    float grv = fastExp(gr * DB_TO_LOG);
+  // copy back to class state, linked channels follow the first so unlinking picks up without a jump.
+  // The gain computer decays into the denormal range on a silent channel, flush it.
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    int from = c < detectors ? c : 0;
+    if (c != from) detector[c] = detector[from];
+    this->rundb[c] = fastAbs(rundb[from]) < C_DENORM ? 0 : rundb[from];
+  }
+}
 
-    spl *= grv * makeupv;
+bool AudioEffectOpticalCompressor::isSettled(void) {
+  // the detector follows the lookahead peak then, it's only quiet once the delay line holds silence
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    if (rundb[c] != 0 || !detector[c].isSettled()) return false;
+  }
+  return true;
+}
 
-    outBlock->data[i] = (int)(spl * FLOAT_TO_INT);
+#if FIXED_POINT_DSP
+/**
+   process() for int16 blocks. The detector's one pole runs in fixed point and gain and makeup are one
+   multiply per sample. The gain computer between them works in dB and is the float one. With lookahead on
+   the block goes through process(), the delay line is float.
+*/
+bool AudioEffectOpticalCompressor::processFixed(int16_t **data) {
+  // pick up any new settings at the block boundary
+  const Params &p = mailbox.read();
+  if (p.lookahead > 0) return false;
+
+  const int detectors = NUM_CHANNELS > 1 && p.linked ? 1 : NUM_CHANNELS;
+
+  int16_t linkedKey[AUDIO_BLOCK_SAMPLES];
+  const int16_t *key[NUM_CHANNELS];
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    meter.measureInput(c, data[c]);
+    key[c] = data[c];
+    // lookahead was just turned off, drop what process() left in the delay line
+    if (lookahead[c].getLength() != 0) lookahead[c].setLength(0);
   }
+  if (detectors < NUM_CHANNELS) EnvelopeFollower::linkKeys(key, linkedKey);
 
-  // send the block and release the memory
-  transmit(outBlock);
+  float level[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+  for (int c = 0; c < detectors; ++c) {
+    detector[c].setCoef(p.rmscoef);
+    detector[c].processFixed(key[c], level[c], EnvelopeLogRms);
+  }
 
-  // copy back to class state
-  this->runave = runave;
-  this->rundb = rundb;
+  float gain[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+  computeGain(p, detectors, level, gain);
 
-  // need to also release the input block because the library uses reference counting...
-  release(inBlock);
-  release(outBlock);
+  float makeupv = p.makeupv;
 
-}
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    const float *g = gain[c < detectors ? c : 0];
+    int16_t *d = data[c];
+    // the cell's gain moves every sample, every sample is a control point
+    applyGainFixed(d, g, makeupv, 0, 0, fixedGain[c]);
 
-float AudioEffectOpticalCompressor::getGainReduction() {
-  return gr;
+    meter.measureGain(c, g);
+    meter.measureOutput(c, d);
+  }
+  meter.record();
+  return true;
 }
+#endif
 
 void AudioEffectOpticalCompressor::setThresholdDb(float thresh) {
-  __disable_irq();
-  threshvRecip = 1.0 / exp(thresh * DB_TO_LOG);
-  Serial.print("threshvRecip: ");
-  Serial.println(threshvRecip);
-
-  __enable_irq();
+  // ln(1 / threshold), added to the detector's log level
+  params.threshLog = -thresh * DB_TO_LOG;
+  mailbox.publish(params);
 }
 
 void AudioEffectOpticalCompressor::setBias(float bias) {
-  __disable_irq();
   // Always have a slight bias. This simpifies later logic.
-  if (bias < 0.1) bias = 0.1;
-  bias *= 0.8;
-  this->biasRecip = 1.0f / bias;
-  Serial.print("biasRecip: ");
-  Serial.println(biasRecip);
-  __enable_irq();
+  if (bias < 0.1f) bias = 0.1f;
+  bias *= 0.8f;
+  params.biasRecip = 1.0f / bias;
+  mailbox.publish(params);
 }
 
 void AudioEffectOpticalCompressor::setMakeupGainDb(float gain) {
-  __disable_irq();
-  makeupv = exp(gain * DB_TO_LOG);
-  Serial.print("makeupv: ");
-  Serial.println(makeupv);
-  __enable_irq();
+  params.makeupv = designDbToGain(gain);
+  mailbox.publish(params);
 }
 
 void AudioEffectOpticalCompressor::setBlownCapacitor(bool blownCap) {
-  __disable_irq();
-  this->capsc = blownCap ? LOG_TO_DB : LOG_TO_DB * BLOWN_CAP_SCALAR;
-  __enable_irq();
+  params.capsc = blownCap ? LOG_TO_DB : LOG_TO_DB * BLOWN_CAP_SCALAR;
+  mailbox.publish(params);
 }
 
 void AudioEffectOpticalCompressor::setTimeConstant(int tc) {
-  __disable_irq();
   float attime, reltime;
   switch (tc) {
     default:
@@ -150,25 +234,33 @@ void AudioEffectOpticalCompressor::setTimeConstant(int tc) {
       break;
   }
 
-  atcoef = exp(-1 / (attime * sampleRate));
-  relcoef = exp(-1 / (reltime * sampleRate));
+  params.atcoef = designTimeCoef(attime, sampleRate);
+  params.relcoef = designTimeCoef(reltime, sampleRate);
 
-  Serial.print("atcoef: ");
-  Serial.println(atcoef);
+  mailbox.publish(params);
+}
 
-  Serial.print("relcoef: ");
-  Serial.println(relcoef);
+void AudioEffectOpticalCompressor::setRmsWindowUs(int windowUs) {
+  float rmstime = (float)windowUs * 0.000001f;
+  params.rmscoef = designTimeCoef(rmstime, sampleRate);
+  mailbox.publish(params);
+}
 
-  __enable_irq();
+/**
+   Delay the audio by 0.1 to 5 ms so the gain is already down when a transient comes out, 0 turns it off.
+   The delay is reported by getLatency(). The delay line is float, with FIXED_POINT_DSP the int16 path is
+   skipped and every block goes through process() while lookahead is on.
+*/
+void AudioEffectOpticalCompressor::setLookaheadMs(float ms) {
+  params.lookahead = LookaheadDelay::msToSamples(ms, sampleRate);
+  mailbox.publish(params);
 }
 
-void AudioEffectOpticalCompressor::setRmsWindowUs(int windowUs) {
-  __disable_irq();
-  float rmstime = (float)windowUs * 0.000001;
-  Serial.print("rmstime: ");
-  Serial.println(rmstime);
-  rmscoef = exp(-1 / (rmstime * sampleRate));
-  Serial.print("rmscoef: ");
-  Serial.println(rmscoef);
-  __enable_irq();
+/**
+   Drive every channel's gain from one detector following the loudest channel, so the stereo image
+   stays put when one side compresses. Off, each channel is compressed on its own.
+*/
+void AudioEffectOpticalCompressor::setLinked(bool linked) {
+  params.linked = linked;
+  mailbox.publish(params);
 }
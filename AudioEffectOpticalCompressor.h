@@ -3,19 +3,45 @@
 
 #include <Arduino.h>
 #include <AudioStream.h>
+#include "AudioStreamFloat.h"
+#include "DynamicsMeter.h"
+#include "EffectProfiler.h"
+#include "ParameterMailbox.h"
+#include "LookaheadDelay.h"
+#include "EnvelopeFollower.h"
 #include "FastMath.h"
+#include "FixedPoint.h"
 
 #define OPT_COMP_RATIO 20
 #define OPT_COMP_RATIO_MINUS_ONE OPT_COMP_RATIO-1
 
-class AudioEffectOpticalCompressor : public AudioStream
+class AudioEffectOpticalCompressor : public AudioStreamFloat
 {
   public:
-    AudioEffectOpticalCompressor() : AudioStream(1, inputQueueArray) {
+    AudioEffectOpticalCompressor() : AudioStreamFloat(NUM_CHANNELS, inputQueueArray, NUM_CHANNELS, inputQueueArrayFloat) {
       // any extra initialization
     }
     void init(float sampleRate);
     virtual void update(void);
+    virtual void process(float **data);
+#if FIXED_POINT_DSP
+    virtual bool processFixed(int16_t **data);
+#endif
+
+    void getProfile(EffectProfile &profile) {
+      profiler.snapshot(profile);
+    }
+    void resetProfile(void) {
+      profiler.reset();
+    }
+
+    // true once the gain reduction has fully released and the detectors have gone quiet
+    virtual bool isSettled(void);
+
+    // levels and gain reduction of the last block, safe to call from loop() while audio is running
+    void getLevels(DynamicsLevels &levels) {
+      meter.snapshot(levels);
+    }
 
     void setThresholdDb(float thresh);
     void setBias(float bias);
@@ -23,20 +49,52 @@ class AudioEffectOpticalCompressor : public AudioStream
     void setBlownCapacitor(bool blownCap);
     void setTimeConstant(int tc);
     void setRmsWindowUs(int windowUs);
-    float getGainReduction() ;
+    void setLookaheadMs(float ms);
+    void setLinked(bool linked);
+
+    // added latency in samples, from the lookahead
+    int getLatency(void) {
+      return params.lookahead;
+    }
 
   private:
-    audio_block_t *inputQueueArray[1];
+    audio_block_t *inputQueueArray[NUM_CHANNELS];
+    audio_block_float_t *inputQueueArrayFloat[NUM_CHANNELS];
+    EffectProfiler profiler;
+    DynamicsMeter meter;
 
     float sampleRate;
 
-    float threshvRecip;
-    float biasRecip;
-    float makeupv;
-    float capsc;
-    float atcoef, relcoef, rmscoef;
-    float runave = 0.0f, rundb = 0.0f;
-    float gr;
+    // everything update() needs, published as one set by the setters
+    struct Params {
+      float threshLog;
+      float biasRecip;
+      float makeupv;
+      float capsc;
+      float atcoef, relcoef, rmscoef;
+
+      // lookahead delay in samples, 0 is off
+      int lookahead = 0;
+
+      // one detector on the loudest channel, its gain applied to all of them
+      bool linked = false;
+    };
+
+    // the first detectors channels' linear gain for every sample from their detector's log level
+    void computeGain(const Params &p, int detectors, float (*level)[AUDIO_BLOCK_SAMPLES],
+                     float (*gain)[AUDIO_BLOCK_SAMPLES]);
+
+    Params params;
+    ParameterMailbox<Params> mailbox;
+    LookaheadDelay lookahead[NUM_CHANNELS];
+
+    // per channel detector state
+    EnvelopeFollower detector[NUM_CHANNELS];
+#if FIXED_POINT_DSP
+    // the gain processFixed() applied last, its integer ramps start from there
+    int32_t fixedGain[NUM_CHANNELS];
+#endif
+    float rundb[NUM_CHANNELS] = {};
 };
 
 #endif /* _AUDIO_EFFECT_OPTICAL_COMP_H */
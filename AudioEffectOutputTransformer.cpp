@@ -1,32 +1,43 @@
 #include "AudioEffectOutputTransformer.h"
 
 void AudioEffectOutputTransformer::update(void) {
-  // work memory
-  audio_block_t *inBlock;
-  audio_block_t *outBlock;
+  uint32_t profileStart = profiler.start();
 
-  inBlock = receiveReadOnly();
-  outBlock = allocate();
+  processBlock();
 
-  if (inBlock == NULL || outBlock == NULL) return;
+  profiler.stop(profileStart);
+}
 
-  // do the saturation stuff
-  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
-    float spl = (float)inBlock->data[i] * INT_TO_FLOAT;
-    spl = fastTanh(drive * spl);
-    outBlock->data[i] = (int)(spl * FLOAT_TO_INT);
-  }
+void AudioEffectOutputTransformer::process(float **data) {
+  const Params &p = mailbox.read();
+  float drive = p.drive;
 
-  // send the block and release the memory
-  transmit(outBlock);
+  // do the saturation stuff, one channel at a time
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    float *spl = data[c];
+    if (p.antiderivativeOrder > 0) {
+      if (p.antiderivativeOrder != tanhStage[c].getOrder()) tanhStage[c].setOrder(p.antiderivativeOrder);
 
-  // need to also release the input block because the library uses reference counting...
-  release(inBlock);
-  release(outBlock);
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) spl[i] *= drive;
+      tanhStage[c].process(spl, AUDIO_BLOCK_SAMPLES);
+    } else {
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+        spl[i] = fastTanh<FastMathPrecise>(drive * spl[i]);
+      }
+    }
+  }
 }
 
 void AudioEffectOutputTransformer::setDrive(float drive) {
-  __disable_irq();
-  this->drive = drive;
-  __enable_irq();
+  params.drive = drive;
+  mailbox.publish(params);
+}
+
+/**
+   0 shapes every sample as it is, 1 or 2 adds antiderivative antialiasing of that order, at a half or one
+   sample delay.
+*/
+void AudioEffectOutputTransformer::setAntiderivativeOrder(int order) {
+  params.antiderivativeOrder = order < 0 ? 0 : (order > 2 ? 2 : order);
+  mailbox.publish(params);
 }
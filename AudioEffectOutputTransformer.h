@@ -4,22 +4,51 @@
 #include <Arduino.h>
 #include <AudioStream.h>
 
+#include "AudioStreamFloat.h"
+#include "EffectProfiler.h"
+#include "ParameterMailbox.h"
 #include "FastMath.h"
+#include "AntiderivativeTanh.h"
 
-class AudioEffectOutputTransformer : public AudioStream
+class AudioEffectOutputTransformer : public AudioStreamFloat
 {
   public:
-    AudioEffectOutputTransformer() : AudioStream(1, inputQueueArray) {
+    AudioEffectOutputTransformer() : AudioStreamFloat(NUM_CHANNELS, inputQueueArray, NUM_CHANNELS, inputQueueArrayFloat) {
       // any extra initialization
     }
     virtual void update(void);
+    virtual void process(float **data);
+
+    void getProfile(EffectProfile &profile) {
+      profiler.snapshot(profile);
+    }
+    void resetProfile(void) {
+      profiler.reset();
+    }
 
     void setDrive(float drive);
+    void setAntiderivativeOrder(int order);
+
+    // added latency in samples, from the antiderivative stage
+    int getLatency(void) {
+      return params.antiderivativeOrder / 2;
+    }
 
   private:
-    audio_block_t *inputQueueArray[1];
+    audio_block_t *inputQueueArray[NUM_CHANNELS];
+    audio_block_float_t *inputQueueArrayFloat[NUM_CHANNELS];
+    EffectProfiler profiler;
+
+    struct Params {
+      float drive = 1.0f;
+      int antiderivativeOrder = 0;
+    };
+
+    Params params;
+    ParameterMailbox<Params> mailbox;
 
-    float drive = 1.0f;
+    // per channel state
+    AntiderivativeTanh tanhStage[NUM_CHANNELS];
 };
 
 #endif /* _AUDIO_EFFECT_OUTPUT_TRANSFORMER_H */
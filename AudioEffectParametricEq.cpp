@@ -1,22 +1,45 @@
+#include <string.h>
 #include <Arduino.h>
 #include <AudioStream.h>
 #include "AudioEffectParametricEq.h"
+#include "CoefficientDesign.h"
 #include "FastMath.h"
 
+/**
+   Blend a block from dry into the processed signal (step > 0) or back out again (step < 0)
+*/
+static void crossfade(float *data, const float *dry, float mix, float step) {
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+    mix += step;
+    data[i] = dry[i] + (data[i] - dry[i]) * mix;
+  }
+}
+
+#if FIXED_POINT_DSP
+// same with mix in AUDIO_BLOCK_SAMPLES steps, 0 dry to AUDIO_BLOCK_SAMPLES processed
+static void crossfadeFixed(int32_t *data, const int32_t *dry, int32_t mix, int32_t step) {
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+    mix += step;
+    data[i] = dry[i] + (int32_t) (((int64_t) (data[i] - dry[i]) * mix) >> FIXED_BLOCK_SHIFT);
+  }
+}
+#endif
+
 void AudioEffectParametricEq::init(float sampleRate) {
 
   this->sampleRate = sampleRate;
   this->maxFrequency = min(sampleRate / 2, MAX_FREQ);
 
+  params.sectionOn[HPF_SECTION] = true;
+  params.sectionOn[LPF_SECTION] = true;
+
   setHpfFreq(hpfFreq);
 
-  __disable_irq();
-  setLowParams(this->lowFreq, this->lowQ, this->lowGain);
-  setLowMidParams(this->lowMidFreq, this->lowMidQ, this->lowMidGain);
-  setHighMidParams(this->highMidFreq, this->highMidQ, this->highMidGain);
-  setHighParams(this->highFreq, this->highQ, this->highGain);
+  setBandParams(LOW_SECTION, this->lowFreq, this->lowQ, this->lowGain);
+  setBandParams(LOW_MID_SECTION, this->lowMidFreq, this->lowMidQ, this->lowMidGain);
+  setBandParams(HIGH_MID_SECTION, this->highMidFreq, this->highMidQ, this->highMidGain);
+  setBandParams(HIGH_SECTION, this->highFreq, this->highQ, this->highGain);
   setOutputGain(this->outGain);
-  __enable_irq();
 
   setLpfFreq(lpfFreq);
 
@@ -24,228 +47,221 @@ void AudioEffectParametricEq::init(float sampleRate) {
 }
 
 void AudioEffectParametricEq::update(void) {
+  uint32_t profileStart = profiler.start();
 
-  // work memory
-  audio_block_t *inBlock;
-  audio_block_t *outBlock;
-
-  inBlock = receiveReadOnly();
-  outBlock = allocate();
-
-  if (inBlock == NULL || outBlock == NULL) return;
-
-  float spl, ospl;
-
-  // get class variables into local variable for better stack usage
-  float b00 = this->b00;
-  float b10 = this->b10;
-  float b20 = this->b20;
-  float a10 = this->a10;
-  float a20 = this->a20;
-
-  float b01 = this->b01;
-  float b11 = this->b11;
-  float b21 = this->b21;
-  float a11 = this->a11;
-  float a21 = this->a21;
-
-  float b03 = this->b03;
-  float b13 = this->b13;
-  float b23 = this->b23;
-  float a13 = this->a13;
-  float a23 = this->a23;
-
-  float b05 = this->b05;
-  float b15 = this->b15;
-  float b25 = this->b25;
-  float a15 = this->a15;
-  float a25 = this->a25;
-
-  float b07 = this->b07;
-  float b17 = this->b17;
-  float b27 = this->b27;
-  float a17 = this->a17;
-  float a27 = this->a27;
-
-  float b09 = this->b09;
-  float b19 = this->b19;
-  float b29 = this->b29;
-  float a19 = this->a19;
-  float a29 = this->a29;
-
-  float _x10 = this->_x10;
-  float x20 = this->x20;
-  float y10 = this->y10;
-  float y20 = this->y20;
-
-  float x11 = this->x11;
-  float x21 = this->x21;
-  float y11 = this->y11;
-  float y21 = this->y21;
-
-  float x13 = this->x13;
-  float x23 = this->x23;
-  float y13 = this->y13;
-  float y23 = this->y23;
-
-  float x15 = this->x15;
-  float _x25 = this->_x25;
-  float y15 = this->y15;
-  float y25 = this->y25;
-
-  float x17 = this->x17;
-  float x27 = this->x27;
-  float y17 = this->y17;
-  float y27 = this->y27;
-
-  float x19 = this->x19;
-  float x29 = this->x29;
-  float y19 = this->y19;
-  float y29 = this->y29;
-
-  // do the EQ'ing
-  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+  processBlock();
+
+  profiler.stop(profileStart);
+}
+
+void AudioEffectParametricEq::process(float **spl) {
+  // pick up any new settings at the block boundary
+  bool changed = mailbox.pending();
+  const Params &p = mailbox.read();
+
+  processFloat(p, changed, spl);
+}
+
+void AudioEffectParametricEq::processFloat(const Params &p, bool changed, float **spl) {
+  // the other topology's state is stale, start it from silence
+  if (haveApplied && p.topology != applied.topology) {
+    for (int s = 0; s < EQ_SECTIONS; ++s) resetSection((Section)s, p.topology);
+  }
 
-    spl = (float)inBlock->data[i] * INT_TO_FLOAT;
-
-    // HPF
-    ospl = spl;
-    spl = b00 * spl + b10 * _x10 + b20 * x20 - a10 * y10 - a20 * y20;
-    x20 = _x10;
-    _x10 = ospl;
-    y20 = y10;
-    y10 = abs(spl) < C_DENORM ? 0 : spl;
-
-    spl += C_DC_ADD;
-
-    //    // LOW
-    if (lowGain != 0.0f) {
-      ospl = spl;
-      spl = b01 * spl + b11 * x11 + b21 * x21 - a11 * y11 - a21 * y21;
-      x21 = x11;
-      x11 = ospl;
-      y21 = y11;
-      y11 = spl;
+  // glide from the settings of the last block to the new ones instead of stepping
+  bool ramp = changed && p.smoothing && haveApplied && p.topology == applied.topology;
+
+  // do the EQ'ing, one section at a time over the whole block
+  processSection(HPF_SECTION, p, ramp, spl);
+
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      spl[c][i] += C_DC_ADD;
     }
+  }
 
-    // LOW-MID
-    if (lowMidGain != 0.0f) {
-      ospl = spl;
-      spl = b03 * spl + b13 * x13 + b23 * x23 - a13 * y13 - a23 * y23;
-      x23 = x13;
-      x13 = ospl;
-      y23 = y13;
-      y13 = spl;
+  uint8_t live[EQ_BANDS];
+  int8_t fade[EQ_BANDS];
+  int numLive = resolveBands(p, live, fade);
+
+  for (int n = 0; n < numLive; ++n) {
+    Section s = (Section)live[n];
+    if (fade[n] == 0) {
+      processSection(s, p, ramp, spl);
+      continue;
     }
 
-    // HIGH-MID
-    if (highMidGain != 0.0f) {
-      ospl = spl;
-      spl = b05 * spl + b15 * x15 + b25 * _x25 - a15 * y15 - a25 * y25;
-      _x25 = x15;
-      x15 = ospl;
-      y25 = y15;
-      y15 = spl;
+    float dry[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+    for (int c = 0; c < NUM_CHANNELS; ++c) memcpy(dry[c], spl[c], sizeof(dry[c]));
+
+    if (fade[n] > 0) {
+      processSection(s, p, ramp, spl);
+      for (int c = 0; c < NUM_CHANNELS; ++c) crossfade(spl[c], dry[c], 0, 1.0f / AUDIO_BLOCK_SAMPLES);
+    } else {
+      // keep running the settings it had until it is faded out
+      processSection(s, applied, false, spl);
+      for (int c = 0; c < NUM_CHANNELS; ++c) crossfade(spl[c], dry[c], 1, -1.0f / AUDIO_BLOCK_SAMPLES);
     }
+  }
+
+  processSection(LPF_SECTION, p, ramp, spl);
 
-    // HIGH
-    if (highGain != 0.0f) {
-      ospl = spl;
-      spl = b07 * spl + b17 * x17 + b27 * x27 - a17 * y17 - a27 * y27;
-      x27 = x17;
-      x17 = ospl;
-      y27 = y17;
-      y17 = spl;
+  float outGainStep = ramp ? (p.outGain - applied.outGain) * (1.0f / AUDIO_BLOCK_SAMPLES) : 0;
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    float outGain = ramp ? applied.outGain : p.outGain;
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      outGain += outGainStep;
+      spl[c][i] *= outGain;
     }
+  }
 
-    // LPF
-    ospl = spl;
-    spl = b09 * spl + b19 * x19 + b29 * x29 - a19 * y19 - a29 * y29;
-    x29 = x19;
-    x19 = ospl;
-    y29 = y19;
-    y19 = spl;
+  if (changed) {
+    applied = p;
+    haveApplied = true;
+  }
+}
+
+/**
+   Resolve the band bypass once per block. Bands at 0dB are flat and skipped, a band that was just
+   switched on starts from cleared state and fades in (fade 1), one that was just switched off fades out
+   (fade -1). Returns the number of bands to run, their sections are in live.
+*/
+int AudioEffectParametricEq::resolveBands(const Params &p, uint8_t *live, int8_t *fade) {
+  int numLive = 0;
+
+  for (int s = LOW_SECTION; s <= HIGH_SECTION; ++s) {
+    bool wasOn = haveApplied ? applied.sectionOn[s] : p.sectionOn[s];
+    if (p.sectionOn[s] == wasOn) {
+      if (!wasOn) continue;
+      fade[numLive] = 0;
+    } else if (p.sectionOn[s]) {
+      resetSection((Section)s, p.topology);
+      fade[numLive] = 1;
+    } else {
+      fade[numLive] = -1;
+    }
+    live[numLive++] = s;
+  }
+  return numLive;
+}
 
-    spl *= outGain;
+#if FIXED_POINT_DSP
+/**
+   process() for int16 blocks, the biquad cascade in fixed point with the same bypass, fades and
+   smoothing. The state variable topology has no fixed point version and runs in float from here, the
+   mailbox has already been read so it can't be handed back to processBlock().
+*/
+bool AudioEffectParametricEq::processFixed(int16_t **data) {
+  // pick up any new settings at the block boundary
+  bool changed = mailbox.pending();
+  const Params &p = mailbox.read();
+
+  if (p.topology != EqBiquad) {
+    float work[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+    float *spl[NUM_CHANNELS];
+    for (int c = 0; c < NUM_CHANNELS; ++c) {
+      spl[c] = work[c];
+      convertToFloat(data[c], work[c]);
+    }
+    processFloat(p, changed, spl);
+    for (int c = 0; c < NUM_CHANNELS; ++c) convertToInt(work[c], data[c]);
+    return true;
+  }
 
-    outBlock->data[i] = (int)(spl * FLOAT_TO_INT);
+  if (haveApplied && p.topology != applied.topology) {
+    for (int s = 0; s < EQ_SECTIONS; ++s) resetSection((Section)s, p.topology);
   }
 
-  // send the block and release the memory
-  transmit(outBlock);
-
-  // need to also release the input block because the library uses reference counting...
-  release(inBlock);
-  release(outBlock);
-
-  // copy back to class state
-
-  this->b00 = b00;
-  this->b10 = b10;
-  this->b20 = b20;
-  this->a10 = a10;
-  this->a20 = a20;
-
-  this->b01 = b01;
-  this->b11 = b11;
-  this->b21 = b21;
-  this->a11 = a11;
-  this->a21 = a21;
-
-  this->b03 = b03;
-  this->b13 = b13;
-  this->b23 = b23;
-  this->a13 = a13;
-  this->a23 = a23;
-
-  this->b05 = b05;
-  this->b15 = b15;
-  this->b25 = b25;
-  this->a15 = a15;
-  this->a25 = a25;
-
-  this->b07 = b07;
-  this->b17 = b17;
-  this->b27 = b27;
-  this->a17 = a17;
-  this->a27 = a27;
-
-  this->b09 = b09;
-  this->b19 = b19;
-  this->b29 = b29;
-  this->a19 = a19;
-  this->a29 = a29;
-
-  this->_x10 = _x10;
-  this->x20 = x20;
-  this->y10 = y10;
-  this->y20 = y20;
-
-  this->x11 = x11;
-  this->x21 = x21;
-  this->y11 = y11;
-  this->y21 = y21;
-
-  this->x13 = x13;
-  this->x23 = x23;
-  this->y13 = y13;
-  this->y23 = y23;
-
-  this->x15 = x15;
-  this->_x25 = _x25;
-  this->y15 = y15;
-  this->y25 = y25;
-
-  this->x17 = x17;
-  this->x27 = x27;
-  this->y17 = y17;
-  this->y27 = y27;
-
-  this->x19 = x19;
-  this->x29 = x29;
-  this->y19 = y19;
-  this->y29 = y29;
+  bool ramp = changed && p.smoothing && haveApplied && p.topology == applied.topology;
 
+  int32_t work[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+  int32_t *spl[NUM_CHANNELS];
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    spl[c] = work[c];
+    fixedFromInt16(data[c], work[c]);
+  }
+
+  // integer state can't go denormal, no DC offset after the HPF
+  processSectionFixed(HPF_SECTION, p, ramp, spl);
+
+  uint8_t live[EQ_BANDS];
+  int8_t fade[EQ_BANDS];
+  int numLive = resolveBands(p, live, fade);
+
+  for (int n = 0; n < numLive; ++n) {
+    Section s = (Section)live[n];
+    if (fade[n] == 0) {
+      processSectionFixed(s, p, ramp, spl);
+      continue;
+    }
+
+    int32_t dry[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+    for (int c = 0; c < NUM_CHANNELS; ++c) memcpy(dry[c], spl[c], sizeof(dry[c]));
+
+    if (fade[n] > 0) {
+      processSectionFixed(s, p, ramp, spl);
+      for (int c = 0; c < NUM_CHANNELS; ++c) crossfadeFixed(spl[c], dry[c], 0, 1);
+    } else {
+      processSectionFixed(s, applied, false, spl);
+      for (int c = 0; c < NUM_CHANNELS; ++c) crossfadeFixed(spl[c], dry[c], AUDIO_BLOCK_SAMPLES, -1);
+    }
+  }
+
+  processSectionFixed(LPF_SECTION, p, ramp, spl);
+
+  // output gain and back to int16 in one multiply and shift
+  const int shift = FIXED_GAIN_BITS + FIXED_SAMPLE_SHIFT;
+  const int64_t half = (int64_t) 1 << (shift - 1);
+  int32_t outGainStep = ramp ? (p.fixedOutGain - applied.fixedOutGain) >> FIXED_BLOCK_SHIFT : 0;
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    int32_t outGain = ramp ? applied.fixedOutGain : p.fixedOutGain;
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      outGain += outGainStep;
+      data[c][i] = saturate16((int32_t) (((int64_t) spl[c][i] * outGain + half) >> shift));
+    }
+  }
+
+  if (changed) {
+    applied = p;
+    haveApplied = true;
+  }
+  return true;
+}
+
+void AudioEffectParametricEq::processSectionFixed(Section section, const Params &p, bool ramp, int32_t **spl) {
+  if (ramp) {
+    fixedFilters.processSectionRamp(section, applied.fixedCoefs, p.fixedCoefs, spl);
+  } else {
+    fixedFilters.processSection(section, p.fixedCoefs, spl);
+  }
+}
+#endif
+
+void AudioEffectParametricEq::processSection(Section section, const Params &p, bool ramp, float **spl) {
+  if (p.topology == EqStateVariable) {
+    if (ramp) {
+      svfFilters.processSectionRamp(section, applied.svf, p.svf, spl);
+    } else {
+      svfFilters.processSection(section, p.svf, spl);
+    }
+  } else {
+    if (ramp) {
+      filters.processSectionRamp(section, applied.coefs, p.coefs, spl);
+    } else {
+      filters.processSection(section, p.coefs, spl);
+    }
+  }
+}
+
+void AudioEffectParametricEq::resetSection(Section section, EqTopology topology) {
+  if (topology == EqStateVariable) {
+    svfFilters.reset(section);
+  } else {
+    filters.reset(section);
+#if FIXED_POINT_DSP
+    fixedFilters.reset(section);
+#endif
+  }
 }
 
 float AudioEffectParametricEq::fixFreq(float freq) {
@@ -253,225 +269,168 @@ float AudioEffectParametricEq::fixFreq(float freq) {
 }
 
 void AudioEffectParametricEq::setHpfFreq(float freq) {
-  __disable_irq();
   this->hpfFreq = fixFreq(freq);
-  a0 = 1;
-  s0 = 1;
-  q0 = 1 / (sqrt((a0 + 1 / a0) * (1 / s0 - 1) + 2));
-  w00 = 2 * PI * this->hpfFreq / sampleRate;
-  cosw00 = cos(w00);
-  sinw00 = sin(w00);
-  alpha0 = sinw00 / (2 * q0);
-
-  b00 = (1 + cosw00) / 2;
-  b10 = -(1 + cosw00);
-  b20 = (1 + cosw00) / 2;
-  a00 = 1 / (1 + alpha0);
-  a10 = -2 * cosw00;
-  a20 = 1 - alpha0;
-  b00 *= a00;
-  b10 *= a00;
-  b20 *= a00;
-  a10 *= a00;
-  a20 *= a00;
-  __enable_irq();
+  float a = 1;
+  float s = 1;
+  float q = 1 / (sqrt((a + 1 / a) * (1 / s - 1) + 2));
+  float w0 = (float) TWO_PI * this->hpfFreq / sampleRate;
+  float sinw0, cosw0;
+  designSinCos(w0, sinw0, cosw0);
+  float alpha = sinw0 / (2 * q);
+
+  params.svf.setHighPass(HPF_SECTION, designTanHalf(w0), q);
+
+  float a0 = 1 / (1 + alpha);
+  params.coefs.setSection(HPF_SECTION,
+                     (1 + cosw0) / 2 * a0,
+                     -(1 + cosw0) * a0,
+                     (1 + cosw0) / 2 * a0,
+                     -2 * cosw0 * a0,
+                     (1 - alpha) * a0);
+#if FIXED_POINT_DSP
+  params.fixedCoefs.setSection(HPF_SECTION, params.coefs);
+#endif
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setLowFreq(float freq) {
-  __disable_irq();
-    this->lowFreq = fixFreq(freq);
-    setLowParams(this->lowFreq, this->lowQ, this->lowGain);
-    __enable_irq();
+  this->lowFreq = fixFreq(freq);
+  setBandParams(LOW_SECTION, this->lowFreq, this->lowQ, this->lowGain);
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setLowQ(float q) {
-  __disable_irq();
   this->lowQ = q;
-  setLowParams(this->lowFreq, this->lowQ, this->lowGain);
-  __enable_irq();
+  setBandParams(LOW_SECTION, this->lowFreq, this->lowQ, this->lowGain);
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setLowGain(float gain) {
-  __disable_irq();
   this->lowGain = gain;
-  setLowParams(this->lowFreq, this->lowQ, this->lowGain);
-  __enable_irq();
-}
-
-void AudioEffectParametricEq::setLowParams(float freq, float q, float gain) {
-  a1 = pow(10, (gain / 40));
-  q1 = q;
-  w01 = 2 * PI * freq / sampleRate;
-  cosw01 = cos(w01);
-  sinw01 = sin(w01);
-  alpha1 = sinw01 / (2 * q1);
-
-  b01 = 1 + alpha1 * a1;
-  b11 = -2 * cosw01;
-  b21 = 1 - alpha1 * a1;
-  a01 = 1 / (1 + alpha1 / a1);
-  a11 = -2 * cosw01;
-  a21 = 1 - alpha1 / a1;
-  b01 *= a01;
-  b11 *= a01;
-  b21 *= a01;
-  a11 *= a01;
-  a21 *= a01;
+  setBandParams(LOW_SECTION, this->lowFreq, this->lowQ, this->lowGain);
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setLowMidFreq(float freq) {
-  __disable_irq();
-  this->lowMidFreq = fixFreq(freq);;
-  setLowMidParams(this->lowMidFreq, this->lowMidQ, this->lowMidGain);
-  __enable_irq();
+  this->lowMidFreq = fixFreq(freq);
+  setBandParams(LOW_MID_SECTION, this->lowMidFreq, this->lowMidQ, this->lowMidGain);
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setLowMidQ(float q) {
-  __disable_irq();
   this->lowMidQ = q;
-  setLowMidParams(this->lowMidFreq, this->lowMidQ, this->lowMidGain);
-  __enable_irq();
+  setBandParams(LOW_MID_SECTION, this->lowMidFreq, this->lowMidQ, this->lowMidGain);
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setLowMidGain(float gain) {
-  __disable_irq();
   this->lowMidGain = gain;
-  setLowMidParams(this->lowMidFreq, this->lowMidQ, this->lowMidGain);
-  __enable_irq();
-}
-
-void AudioEffectParametricEq::setLowMidParams(float freq, float q, float gain) {
-  a3 = pow(10, (gain / 40));
-  q3 = q;
-  w03 = 2 * PI * freq / sampleRate;
-  cosw03 = cos(w03);
-  sinw03 = sin(w03);
-  alpha3 = sinw03 / (2 * q3);
-
-  b03 = 1 + alpha3 * a3;
-  b13 = -2 * cosw03;
-  b23 = 1 - alpha3 * a3;
-  a03 = 1 / (1 + alpha3 / a3);
-  a13 = -2 * cosw03;
-  a23 = 1 - alpha3 / a3;
-  b03 *= a03;
-  b13 *= a03;
-  b23 *= a03;
-  a13 *= a03;
-  a23 *= a03;
+  setBandParams(LOW_MID_SECTION, this->lowMidFreq, this->lowMidQ, this->lowMidGain);
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setHighMidFreq(float freq) {
-  __disable_irq();
-  this->highMidFreq = fixFreq(freq);;
-  setHighMidParams(this->highMidFreq, this->highMidQ, this->highMidGain);
-  __enable_irq();
+  this->highMidFreq = fixFreq(freq);
+  setBandParams(HIGH_MID_SECTION, this->highMidFreq, this->highMidQ, this->highMidGain);
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setHighMidQ(float q) {
-  __disable_irq();
   this->highMidQ = q;
-  setHighMidParams(this->highMidFreq, this->highMidQ, this->highMidGain);
-  __enable_irq();
+  setBandParams(HIGH_MID_SECTION, this->highMidFreq, this->highMidQ, this->highMidGain);
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setHighMidGain(float gain) {
-  __disable_irq();
   this->highMidGain = gain;
-  setHighMidParams(this->highMidFreq, this->highMidQ, this->highMidGain);
-  __enable_irq();
-}
-
-void AudioEffectParametricEq::setHighMidParams(float freq, float q, float gain) {
-  a5 = pow(10, (gain / 40));
-  q5 = q;
-  w05 = 2 * PI * freq / sampleRate;
-  cosw05 = cos(w05);
-  sinw05 = sin(w05);
-  alpha5 = sinw05 / (2 * q5);
-
-  b05 = 1 + alpha5 * a5;
-  b15 = -2 * cosw05;
-  b25 = 1 - alpha5 * a5;
-  a05 = 1 + alpha5 / a5;
-  a15 = -2 * cosw05;
-  a25 = 1 - alpha5 / a5;
-  b05 /= a05;
-  b15 /= a05;
-  b25 /= a05;
-  a15 /= a05;
-  a25 /= a05;
+  setBandParams(HIGH_MID_SECTION, this->highMidFreq, this->highMidQ, this->highMidGain);
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setHighFreq(float freq) {
-  __disable_irq();
-  this->highFreq = fixFreq(freq);;
-  setHighParams(this->highFreq, this->highQ, this->highGain);
-  __enable_irq();
+  this->highFreq = fixFreq(freq);
+  setBandParams(HIGH_SECTION, this->highFreq, this->highQ, this->highGain);
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setHighQ(float q) {
-  __disable_irq();
   this->highQ = q;
-  setHighParams(this->highFreq, this->highQ, this->highGain);
-  __enable_irq();
+  setBandParams(HIGH_SECTION, this->highFreq, this->highQ, this->highGain);
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setHighGain(float gain) {
-  __disable_irq();
   this->highGain = gain;
-  setHighParams(this->highFreq, this->highQ, this->highGain);
-  __enable_irq();
+  setBandParams(HIGH_SECTION, this->highFreq, this->highQ, this->highGain);
+  mailbox.publish(params);
 }
 
-void AudioEffectParametricEq::setHighParams(float freq, float q, float gain) {
-  a7 = pow(10, (gain / 40.0f));
-  q7 = q;
-  w07 = 2 * PI * freq / sampleRate;
-  cosw07 = cos(w07);
-  sinw07 = sin(w07);
-  alpha7 = sinw07 / (2 * q7);
-
-  b07 = 1 + alpha7 * a7;
-  b17 = -2 * cosw07;
-  b27 = 1 - alpha7 * a7;
-  a07 = 1 / (1 + alpha7 / a7);
-  a17 = -2 * cosw07;
-  a27 = 1 - alpha7 / a7;
-  b07 *= a07;
-  b17 *= a07;
-  b27 *= a07;
-  a17 *= a07;
-  a27 *= a07;
+/**
+   RBJ peaking EQ, shared by all four bands
+*/
+void AudioEffectParametricEq::setBandParams(Section section, float freq, float q, float gain) {
+  params.sectionOn[section] = gain != 0.0f;
+
+  float a = designDbToGain(gain / 2);
+  float w0 = (float) TWO_PI * freq / sampleRate;
+  float sinw0, cosw0;
+  designSinCos(w0, sinw0, cosw0);
+  float alpha = sinw0 / (2 * q);
+
+  params.svf.setPeaking(section, designTanHalf(w0), q, a);
+
+  float a0 = 1 / (1 + alpha / a);
+  params.coefs.setSection(section,
+                     (1 + alpha * a) * a0,
+                     -2 * cosw0 * a0,
+                     (1 - alpha * a) * a0,
+                     -2 * cosw0 * a0,
+                     (1 - alpha / a) * a0);
+#if FIXED_POINT_DSP
+  params.fixedCoefs.setSection(section, params.coefs);
+#endif
 }
 
 void AudioEffectParametricEq::setLpfFreq(float freq) {
-  __disable_irq();
-  this->lpfFreq = fixFreq(freq);;
-  a9 = 1;
-  s9 = 2;
-  q9 = 1 / (sqrt((a9 + 1 / a9) * (1 / s9 - 1) + 2));
-  w09 = 2 * PI * this->lpfFreq / sampleRate;
-  cosw09 = cos(w09);
-  sinw09 = sin(w09);
-  alpha9 = sinw09 / (2 * q9);
-
-  b09 = (1 - cosw09) / 2;
-  b19 = (1 - cosw09);
-  b29 = (1 - cosw09) / 2;
-  a09 = 1 / (1 + alpha9);
-  a19 = -2 * cosw09;
-  a29 = 1 - alpha9;
-  b09 *= a09;
-  b19 *= a09;
-  b29 *= a09;
-  a19 *= a09;
-  a29 *= a09;
-  __enable_irq();
+  this->lpfFreq = fixFreq(freq);
+  float a = 1;
+  float s = 2;
+  float q = 1 / (sqrt((a + 1 / a) * (1 / s - 1) + 2));
+  float w0 = (float) TWO_PI * this->lpfFreq / sampleRate;
+  float sinw0, cosw0;
+  designSinCos(w0, sinw0, cosw0);
+  float alpha = sinw0 / (2 * q);
+
+  params.svf.setLowPass(LPF_SECTION, designTanHalf(w0), q);
+
+  float a0 = 1 / (1 + alpha);
+  params.coefs.setSection(LPF_SECTION,
+                     (1 - cosw0) / 2 * a0,
+                     (1 - cosw0) * a0,
+                     (1 - cosw0) / 2 * a0,
+                     -2 * cosw0 * a0,
+                     (1 - alpha) * a0);
+#if FIXED_POINT_DSP
+  params.fixedCoefs.setSection(LPF_SECTION, params.coefs);
+#endif
+  mailbox.publish(params);
 }
 
 void AudioEffectParametricEq::setOutputGain(float gain) {
-  __disable_irq();
-  this->outGain = pow(10, gain / 20);
-  __enable_irq();
+  this->outGain = gain;
+  params.outGain = designDbToGain(gain);
+#if FIXED_POINT_DSP
+  params.fixedOutGain = floatToFixed(params.outGain, FIXED_GAIN_BITS);
+#endif
+  mailbox.publish(params);
+}
+
+void AudioEffectParametricEq::setTopology(EqTopology topology) {
+  params.topology = topology;
+  mailbox.publish(params);
+}
+
+void AudioEffectParametricEq::setSmoothing(bool smoothing) {
+  params.smoothing = smoothing;
+  mailbox.publish(params);
 }
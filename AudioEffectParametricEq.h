@@ -2,15 +2,44 @@
 #define _AUDIO_EFFECT_PARA_EQ_H
 
 #include "AudioStream.h"
+#include "BiquadCascade.h"
+#include "BiquadCascadeFixed.h"
+#include "SvfCascade.h"
+#include "AudioStreamFloat.h"
+#include "EffectProfiler.h"
+#include "ParameterMailbox.h"
+
+// HPF, four peaking bands and LPF
+#define EQ_SECTIONS 6
+#define EQ_BANDS 4
+
+/*
+   EqBiquad is the classic RBJ biquad cascade. EqStateVariable computes the same responses with
+   trapezoidal state variable filters, which stay clean when the frequency is swept quickly.
+*/
+enum EqTopology {
+  EqBiquad, EqStateVariable
+};
 
-class AudioEffectParametricEq : public AudioStream {
+class AudioEffectParametricEq : public AudioStreamFloat {
   public:
-    AudioEffectParametricEq() : AudioStream(1, inputQueueArray) {
+    AudioEffectParametricEq() : AudioStreamFloat(NUM_CHANNELS, inputQueueArray, NUM_CHANNELS, inputQueueArrayFloat) {
       // any extra initialization
     }
     void init(float sampleRate);
 
     virtual void update(void);
+    virtual void process(float **data);
+#if FIXED_POINT_DSP
+    virtual bool processFixed(int16_t **data);
+#endif
+
+    void getProfile(EffectProfile &profile) {
+      profiler.snapshot(profile);
+    }
+    void resetProfile(void) {
+      profiler.reset();
+    }
 
     void setHpfFreq(float freq);
     void setLowFreq(float freq);
@@ -27,15 +56,29 @@ class AudioEffectParametricEq : public AudioStream {
     void setHighGain(float gain);
     void setLpfFreq(float freq);
     void setOutputGain(float gain);
+    void setTopology(EqTopology topology);
+    void setSmoothing(bool smoothing);
 
   private:
-    audio_block_t *inputQueueArray[1];
+    audio_block_t *inputQueueArray[NUM_CHANNELS];
+    audio_block_float_t *inputQueueArrayFloat[NUM_CHANNELS];
+    EffectProfiler profiler;
 
-    void setLowParams(float freq, float q, float gain);
-    void setLowMidParams(float freq, float q, float gain);
-    void setHighMidParams(float freq, float q, float gain);
-    void setHighParams(float freq, float q, float gain);
+    enum Section {
+      HPF_SECTION, LOW_SECTION, LOW_MID_SECTION, HIGH_MID_SECTION, HIGH_SECTION, LPF_SECTION
+    };
+
+    struct Params;
+
+    void setBandParams(Section section, float freq, float q, float gain);
     float fixFreq(float freq);
+    void processFloat(const Params &p, bool changed, float **spl);
+    int resolveBands(const Params &p, uint8_t *live, int8_t *fade);
+    void processSection(Section section, const Params &p, bool ramp, float **spl);
+#if FIXED_POINT_DSP
+    void processSectionFixed(Section section, const Params &p, bool ramp, int32_t **spl);
+#endif
+    void resetSection(Section section, EqTopology topology);
 
     float sampleRate;
     float maxFrequency;
@@ -57,99 +100,31 @@ class AudioEffectParametricEq : public AudioStream {
     float lpfFreq = 5000;
     float outGain = -3;
 
-    float a0;
-    float s0;
-    float q0;
-    float w00;
-    float cosw00;
-    float sinw00;
-    float alpha0;
-
-    float b00;
-    float b10;
-    float b20;
-    float a00;
-    float a10;
-    float a20;
-
-    float a1;
-    float q1;
-    float w01;
-    float cosw01;
-    float sinw01;
-    float alpha1;
-
-    float b01;
-    float b11;
-    float b21;
-    float a01;
-    float a11;
-    float a21;
-
-    float a3;
-    float q3;
-    float w03;
-    float cosw03;
-    float sinw03;
-    float alpha3;
-
-    float b03;
-    float b13;
-    float b23;
-    float a03;
-    float a13;
-    float a23;
-
-    float a5;
-    float q5;
-    float w05;
-    float cosw05;
-    float sinw05;
-    float alpha5;
-
-    float b05;
-    float b15;
-    float b25;
-    float a05;
-    float a15;
-    float a25;
-
-    float a7;
-    float q7;
-    float w07;
-    float cosw07;
-    float sinw07;
-    float alpha7;
-
-    float b07;
-    float b17;
-    float b27;
-    float a07;
-    float a17;
-    float a27;
-
-    float a9;
-    float s9;
-    float q9;
-    float w09;
-    float cosw09;
-    float sinw09;
-    float alpha9;
-
-    float b09;
-    float b19;
-    float b29;
-    float a09;
-    float a19;
-    float a29;
-
-    float y10, y20, _x10, x20;
-    float y11, y21, x11, x21;
-    float y13, y23, x13, x23;
-    float y15, y25, x15, _x25;
-    float y17, y27, x17, x27;
-    float y19, y29, x19, x29;
-
+    // everything update() needs, published as one set by the setters
+    struct Params {
+      BiquadCoefficients<EQ_SECTIONS> coefs;
+      SvfCoefficients<EQ_SECTIONS> svf;
+      bool sectionOn[EQ_SECTIONS];
+      float outGain;
+      EqTopology topology = EqBiquad;
+      bool smoothing = true;
+#if FIXED_POINT_DSP
+      BiquadCoefficientsFixed<EQ_SECTIONS> fixedCoefs;
+      int32_t fixedOutGain;
+#endif
+    };
+
+    Params params;
+    ParameterMailbox<Params> mailbox;
+    BiquadCascade<EQ_SECTIONS, NUM_CHANNELS> filters;
+    SvfCascade<EQ_SECTIONS, NUM_CHANNELS> svfFilters;
+#if FIXED_POINT_DSP
+    BiquadCascadeFixed<EQ_SECTIONS, NUM_CHANNELS> fixedFilters;
+#endif
+
+    // audio side copy of the settings the last block ended on, the start point of a ramp
+    Params applied;
+    bool haveApplied = false;
 };
 
 #endif /* _AUDIO_EFFECT_PARA_EQ_H */
@@ -0,0 +1,24 @@
+#include "AudioEffectPreampChain.h"
+
+void AudioEffectPreampChain::init(float sampleRate) {
+  tubeSat.init(sampleRate);
+  optComp.init(sampleRate);
+  paraEq.init(sampleRate);
+  fetComp.init(sampleRate);
+}
+
+void AudioEffectPreampChain::update(void) {
+  uint32_t profileStart = profiler.start();
+
+  processBlock();
+
+  profiler.stop(profileStart);
+}
+
+void AudioEffectPreampChain::process(float **data) {
+  tubeSat.process(data);
+  optComp.process(data);
+  paraEq.process(data);
+  fetComp.process(data);
+  outTrans.process(data);
+}
@@ -0,0 +1,78 @@
+#ifndef _AUDIO_EFFECT_PREAMP_CHAIN_H
+#define _AUDIO_EFFECT_PREAMP_CHAIN_H
+
+#include <Arduino.h>
+#include <AudioStream.h>
+
+#include "AudioStreamFloat.h"
+#include "AudioEffectTubeSaturation.h"
+#include "AudioEffectOpticalCompressor.h"
+#include "AudioEffectParametricEq.h"
+#include "AudioEffectFetCompressor.h"
+#include "AudioEffectOutputTransformer.h"
+#include "EffectProfiler.h"
+
+/*
+   The preamp effects fused into one audio object:
+     tube saturation -> optical compressor -> parametric EQ -> FET compressor -> output transformer
+
+   Each block is received, allocated and transmitted once and stays in one float buffer while every stage's
+   process() runs over it, so the output is the same as patching the stages with float connections.
+   Configure the stages through the getters, they are never patched or updated on their own.
+*/
+class AudioEffectPreampChain : public AudioStreamFloat
+{
+  public:
+    AudioEffectPreampChain() : AudioStreamFloat(NUM_CHANNELS, inputQueueArray, NUM_CHANNELS, inputQueueArrayFloat) {
+      // any extra initialization
+    }
+    void init(float sampleRate);
+    virtual void update(void);
+    virtual void process(float **data);
+
+    void getProfile(EffectProfile &profile) {
+      profiler.snapshot(profile);
+    }
+    void resetProfile(void) {
+      profiler.reset();
+    }
+
+    // added latency in samples, from the saturation stages' antialiasing and the compressors' lookahead
+    // the compressors are the stages that keep moving on silence
+    virtual bool isSettled(void) {
+      return optComp.isSettled() && fetComp.isSettled();
+    }
+
+    int getLatency(void) {
+      return tubeSat.getLatency() + optComp.getLatency() + fetComp.getLatency() + outTrans.getLatency();
+    }
+
+    AudioEffectTubeSaturation &getTubeSaturation(void) {
+      return tubeSat;
+    }
+    AudioEffectOpticalCompressor &getOpticalCompressor(void) {
+      return optComp;
+    }
+    AudioEffectParametricEq &getParametricEq(void) {
+      return paraEq;
+    }
+    AudioEffectFetCompressor &getFetCompressor(void) {
+      return fetComp;
+    }
+    AudioEffectOutputTransformer &getOutputTransformer(void) {
+      return outTrans;
+    }
+
+  private:
+    audio_block_t *inputQueueArray[NUM_CHANNELS];
+    audio_block_float_t *inputQueueArrayFloat[NUM_CHANNELS];
+    EffectProfiler profiler;
+
+    AudioEffectTubeSaturation tubeSat;
+    AudioEffectOpticalCompressor optComp;
+    AudioEffectParametricEq paraEq;
+    AudioEffectFetCompressor fetComp;
+    AudioEffectOutputTransformer outTrans;
+};
+
+#endif /* _AUDIO_EFFECT_PREAMP_CHAIN_H */
@@ -1,4 +1,5 @@
 #include "AudioEffectTubeSaturation.h"
+#include "CoefficientDesign.h"
 #include "FastMath.h"
 
 void AudioEffectTubeSaturation::init(float sampleRate) {
@@ -11,43 +12,80 @@ void AudioEffectTubeSaturation::init(float sampleRate) {
 }
 
 void AudioEffectTubeSaturation::update(void) {
-  // work memory
-  audio_block_t *inBlock;
-  audio_block_t *outBlock;
+  uint32_t profileStart = profiler.start();
 
-  inBlock = receiveReadOnly();
-  outBlock = allocate();
+  processBlock();
 
-  if (inBlock == NULL || outBlock == NULL) return;
+  profiler.stop(profileStart);
+}
 
-  // do the saturation stuff
-  for (int i = 0; i != AUDIO_BLOCK_SAMPLES; ++i) {
+void AudioEffectTubeSaturation::process(float **data) {
+  // pick up any new settings at the block boundary
+  const Params &p = mailbox.read();
+
+  float drive = p.drive;
+  float makeupGain = p.makeupGain;
+  float alpha = p.alpha;
+
+  // copy from class state
+  float *d[NUM_CHANNELS];
+  float lastSatSpl[NUM_CHANNELS], lastLpfSpl[NUM_CHANNELS];
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    d[c] = data[c];
+    lastSatSpl[c] = this->lastSatSpl[c];
+    lastLpfSpl[c] = this->lastLpfSpl[c];
+  }
+
+  bool useTable = p.antiderivativeOrder == 0 && p.shaper != TubeFormula;
+  if (useTable) updateTable(drive);
+
+  // saturation, run oversampled so the harmonics above the base rate's Nyquist are filtered out instead
+  // of folding back down
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    if (p.oversampling != oversampler[c].getFactor()) oversampler[c].setFactor(p.oversampling);
+
+    float *over = oversampler[c].upsample(d[c]);
+    int n = oversampler[c].getFactor() * AUDIO_BLOCK_SAMPLES;
+    if (p.antiderivativeOrder > 0) {
+      if (p.antiderivativeOrder != tanhStage[c].getOrder()) {
+        tanhStage[c].setOrder(p.antiderivativeOrder);
+        harmonicsHistory[c][0] = harmonicsHistory[c][1] = 0;
+      }
+      saturateAntiderivative(over, n, drive, c);
+    } else if (useTable) {
+      saturateTable(over, n, table, p.shaper == TubeTableCubic);
+    } else {
+      saturate(over, n, drive);
+    }
+    oversampler[c].downsample(d[c]);
+  }
 
-    inSpl = (float)inBlock->data[i] * INT_TO_FLOAT;
+  // do the filtering, all channels of a sample together
+  for (int i = 0; i != AUDIO_BLOCK_SAMPLES; ++i) {
+    for (int c = 0; c < NUM_CHANNELS; ++c) {
 
-    // saturation
-    satSpl = saturation(lastSpl, inSpl, drive);
-    lastSpl = inSpl;
+      float satSpl = d[c][i];
 
-    // LPF
-    spl = lastSatSpl + alpha * (satSpl - lastSatSpl);
+      // LPF
+      float spl = lastSatSpl[c] + alpha * (satSpl - lastSatSpl[c]);
 
-    lastSatSpl = satSpl;
+      lastSatSpl[c] = satSpl;
 
-    // Low pass filter
-    lastLpfSpl = spl = lastLpfSpl + alpha * (spl - lastLpfSpl);
+      // Low pass filter
+      lastLpfSpl[c] = spl = lastLpfSpl[c] + alpha * (spl - lastLpfSpl[c]);
 
-    spl *= makeupGain;
+      spl *= makeupGain;
 
-    outBlock->data[i] = (int)(spl * FLOAT_TO_INT);
+      d[c][i] = spl;
+    }
   }
 
-  // send the block and release the memory
-  transmit(outBlock);
-
-  // need to also release the input block because the library uses reference counting...
-  release(inBlock);
-  release(outBlock);
+  // copy back to class state. On a silent channel the low pass decays into the denormal range and
+  // stays there, rounding never takes it to zero.
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    this->lastSatSpl[c] = lastSatSpl[c];
+    this->lastLpfSpl[c] = fastAbs(lastLpfSpl[c]) < C_DENORM ? 0 : lastLpfSpl[c];
+  }
 }
 
 /*
@@ -69,9 +107,9 @@ void AudioEffectTubeSaturation::update(void) {
 
   https://en.wikipedia.org/wiki/Chebyshev_polynomials
 */
-#define ROOT_SCALAR 1.0
-#define SECOND_SCALAR 0.5
-#define FOURTH_SCALAR 0.2
+#define ROOT_SCALAR 1.0f
+#define SECOND_SCALAR 0.5f
+#define FOURTH_SCALAR 0.2f
 
 float AudioEffectTubeSaturation::addEvenOrderHarmonics(float x) {
   float x2 = x * x;
@@ -90,87 +128,189 @@ float AudioEffectTubeSaturation::addEvenOrderHarmonics(float x) {
 }
 
 /**
-   Use linear interpolation for anti-aliasing. Using fixed constant steps to avoid divides.
-   Generate even order harrmonics then drive through tanh.
-   y0 is last input and y2 is current input.
-   antiAliasSteps is the oversampling amount:
-      - range 1 to 8
-      - suggested 2 to 4?
-      - if using antiAliasSteps=1, then y0 should be 0
+   Generate even order harmonics then drive through tanh, n samples in place.
    drive is a value between 0.0 and 1.0
 */
-float AudioEffectTubeSaturation::saturation(float y0, float y2, float drive) {
-
-#if OVERSAMPLING < 2
-  return fastTanh(drive * addEvenOrderHarmonics(y2));
-#endif
-
-#if OVERSAMPLING > 1
-  float sum = 0.0;
-
-  // over an x delta of 1, so simple math
-  float m = y2 - y0;
-
-#if OVERSAMPLING == 2
-  sum += fastTanh(drive * addEvenOrderHarmonics(m * 0.5 + y0));
-  sum += fastTanh(drive * addEvenOrderHarmonics(y2));
-  return sum * 0.5;
-
-#elif OVERSAMPLING == 4
-  float mStep = m * 0.25;
-  float w = y0 + mStep;
-  sum += fastTanh(drive * addEvenOrderHarmonics(w));
-  w += mStep;
-  sum += fastTanh(drive * addEvenOrderHarmonics(w));
-  w += mStep;
-  sum += fastTanh(drive * addEvenOrderHarmonics(w));
-  sum += fastTanh(drive * addEvenOrderHarmonics(y2));
-  return sum * 0.25;
-
-#elif OVERSAMPLING == 8
-  float mStep = m * 0.125;
-  float w = y0 + mStep;
-  sum += fastTanh(drive * addEvenOrderHarmonics(w));
-  w += mStep;
-  sum += fastTanh(drive * addEvenOrderHarmonics(w));
-  w += mStep;
-  sum += fastTanh(drive * addEvenOrderHarmonics(w));
-  w += mStep;
-  sum += fastTanh(drive * addEvenOrderHarmonics(w));
-  w += mStep;
-  sum += fastTanh(drive * addEvenOrderHarmonics(w));
-  w += mStep;
-  sum += fastTanh(drive * addEvenOrderHarmonics(w));
-  w += mStep;
-  sum += fastTanh(drive * addEvenOrderHarmonics(w));
-  sum += fastTanh(drive * addEvenOrderHarmonics(y2));
-  return sum * 0.125;
-
-#else
-  // just pass through newest value
-  return y2;
-
-#endif
-
-#endif  // OVERSAMPLING > 1
+void AudioEffectTubeSaturation::saturate(float *data, int n, float drive) {
+  for (int i = 0; i < n; ++i) {
+    data[i] = drive * addEvenOrderHarmonics(data[i]);
+  }
+  for (int i = 0; i < n; i += AUDIO_BLOCK_SAMPLES) {
+    fastTanhBlock<FastMathPrecise>(data + i, data + i);
+  }
+}
+
+/**
+   saturate() with antiderivative antialiasing, as two cascaded stages: the harmonics polynomial and then
+   fastTanh(), each averaged over the segment (first order) or triangle (second order) spanned by its
+   latest inputs. Each stage delays by half a sample per order.
+
+   The polynomial's divided differences are polynomials themselves, so they are exact and need no special
+   case for close samples. For p(x) = X1 x + X3 x^3 + X5 x^5, first order is the divided difference of its
+   antiderivative and second order twice the second divided difference of the one after that, which for
+   x^n is the sum of all the degree n - 2 monomials in the three samples.
+*/
+// the polynomial addEvenOrderHarmonics() expands to
+#define HARMONICS_X1 ((float)(ROOT_SCALAR + 2 * SECOND_SCALAR))
+#define HARMONICS_X3 ((float)(-4 * SECOND_SCALAR))
+#define HARMONICS_X5 ((float)(12 * SECOND_SCALAR))
+
+void AudioEffectTubeSaturation::saturateAntiderivative(float *data, int n, float drive, int channel) {
+  AntiderivativeTanh &tanhStage = this->tanhStage[channel];
+
+  // copy from class state
+  float x1 = harmonicsHistory[channel][0];
+  float x2 = harmonicsHistory[channel][1];
+
+  if (tanhStage.getOrder() == 1) {
+    for (int i = 0; i < n; ++i) {
+      float x0 = data[i];
+      float sum = x0 + x1;
+      float sq0 = x0 * x0, sq1 = x1 * x1;
+      float y = sum * (HARMONICS_X1 / 2 + (sq0 + sq1) * (HARMONICS_X3 / 4) +
+                       (sq0 * sq0 + sq0 * sq1 + sq1 * sq1) * (HARMONICS_X5 / 6));
+      data[i] = drive * y;
+      x1 = x0;
+    }
+  } else {
+    for (int i = 0; i < n; ++i) {
+      float x0 = data[i];
+
+      // complete homogeneous sums of degree 1 to 5, over (x1, x2) in pair and over all three in h1..h5
+      float x2Power = x2, pair = x1 + x2;
+      float h1 = x0 + pair;
+      x2Power *= x2;
+      pair = x1 * pair + x2Power;
+      float h2 = x0 * h1 + pair;
+      x2Power *= x2;
+      pair = x1 * pair + x2Power;
+      float h3 = x0 * h2 + pair;
+      x2Power *= x2;
+      pair = x1 * pair + x2Power;
+      float h4 = x0 * h3 + pair;
+      x2Power *= x2;
+      pair = x1 * pair + x2Power;
+      float h5 = x0 * h4 + pair;
+
+      float y = h1 * (HARMONICS_X1 / 3) + h3 * (HARMONICS_X3 / 10) + h5 * (HARMONICS_X5 / 21);
+      data[i] = drive * y;
+      x2 = x1;
+      x1 = x0;
+    }
+  }
+
+  // copy back to class state
+  harmonicsHistory[channel][0] = x1;
+  harmonicsHistory[channel][1] = x2;
+
+  tanhStage.process(data, n);
+}
+
+/**
+   The table modes' saturate(), the curve looked up in values.
+*/
+void AudioEffectTubeSaturation::saturateTable(float *data, int n, const float *values, bool cubic) {
+  const float *table = values + 1;
+  const float scale = (TUBE_TABLE_SIZE - 1) / (2 * TUBE_TABLE_RANGE);
+  const float last = TUBE_TABLE_SIZE - 1;
+
+  if (cubic) {
+    for (int i = 0; i < n; ++i) {
+      float pos = (data[i] + TUBE_TABLE_RANGE) * scale;
+      pos = pos < 0 ? 0 : (pos > last ? last : pos);
+      int j = (int)pos;
+      float f = pos - j;
+      const float *t = table + j;
+
+      // Catmull-Rom through t[-1]..t[2]
+      float a = t[-1], b = t[0], c = t[1], e = t[2];
+      data[i] = b + 0.5f * f * (c - a + f * (2 * a - 5 * b + 4 * c - e + f * (3 * (b - c) + e - a)));
+    }
+  } else {
+    for (int i = 0; i < n; ++i) {
+      float pos = (data[i] + TUBE_TABLE_RANGE) * scale;
+      pos = pos < 0 ? 0 : (pos > last ? last : pos);
+      int j = (int)pos;
+      float f = pos - j;
+      const float *t = table + j;
+
+      data[i] = t[0] + f * (t[1] - t[0]);
+    }
+  }
+}
+
+/**
+   Keep the table on drive, at the block boundary. Only the drive goes through the mailbox, the table is
+   baked here into the one not in use, TUBE_TABLE_BUILD_STEP entries a block so a turned knob doesn't cost
+   a block its deadline, and table is swapped over once every entry is in. The very first table has
+   nothing to stand in for it and is built in one go.
+*/
+void AudioEffectTubeSaturation::updateTable(float drive) {
+  if (buildIndex < 0) {
+    if (tableBuilt && drive == tableDrive) return;
+    buildIndex = 0;
+  }
+  // a drive that moved again mid build starts it over
+  if (drive != buildDrive) buildIndex = 0;
+  buildDrive = drive;
+
+  float *values = table == tables[0] ? tables[1] : tables[0];
+  const float step = 2 * TUBE_TABLE_RANGE / (TUBE_TABLE_SIZE - 1);
+  int end = tableBuilt ? buildIndex + TUBE_TABLE_BUILD_STEP : TUBE_TABLE_SIZE + 3;
+  if (end > TUBE_TABLE_SIZE + 3) end = TUBE_TABLE_SIZE + 3;
+
+  for (int i = buildIndex; i < end; ++i) {
+    float x = -TUBE_TABLE_RANGE + (i - 1) * step;
+    values[i] = fastTanh<FastMathPrecise>(drive * addEvenOrderHarmonics(x));
+  }
+
+  if (end < TUBE_TABLE_SIZE + 3) {
+    buildIndex = end;
+    return;
+  }
+  table = values;
+  tableDrive = drive;
+  tableBuilt = true;
+  buildIndex = -1;
 }
 
 void AudioEffectTubeSaturation::setDrive(float drive) {
-  __disable_irq();
-  this->drive = drive;
-  __enable_irq();
+  params.drive = drive;
+  mailbox.publish(params);
 }
 
 void AudioEffectTubeSaturation::setMakeupGainDb(float gain) {
-  __disable_irq();
-  makeupGain = exp(gain * DB_TO_LOG);
-  __enable_irq();
+  params.makeupGain = designDbToGain(gain);
+  mailbox.publish(params);
 }
 
 void AudioEffectTubeSaturation::setLpfFrequency(float freq) {
-  __disable_irq();
-  float RC = 1.0 / (freq * 2 * PI);
-  float dt = 1.0 / sampleRate;
-  alpha = dt / (RC + dt);
-  __enable_irq();
+  float RC = 1 / (freq * (float) TWO_PI);
+  float dt = 1 / sampleRate;
+  params.alpha = dt / (RC + dt);
+  mailbox.publish(params);
+}
+
+/**
+   Run the saturation at 1, 2, 4 or 8 times the sample rate, others are rounded down to one of those.
+   The half-band filters add the delay reported by getLatency().
+*/
+void AudioEffectTubeSaturation::setOversampling(int factor) {
+  params.oversampling = HalfBandOversampler::roundFactor(factor);
+  mailbox.publish(params);
+}
+
+/**
+   0 shapes every sample as it is, 1 or 2 adds antiderivative antialiasing of that order, at a half or one
+   sample delay per stage. Works at any oversampling factor, at 1x second order takes the place of
+   oversampling for a fraction of its cost.
+*/
+void AudioEffectTubeSaturation::setAntiderivativeOrder(int order) {
+  params.antiderivativeOrder = order < 0 ? 0 : (order > 2 ? 2 : order);
+  mailbox.publish(params);
+}
+
+void AudioEffectTubeSaturation::setShaper(TubeShaper shaper) {
+  params.shaper = shaper;
+  mailbox.publish(params);
 }
@@ -3,41 +3,107 @@
 
 #include <Arduino.h>
 #include <AudioStream.h>
+#include "AudioStreamFloat.h"
+#include "EffectProfiler.h"
+#include "ParameterMailbox.h"
+#include "HalfBandOversampler.h"
+#include "AntiderivativeTanh.h"
 
-// valid values 1, 2, 4, and 8
-#define OVERSAMPLING 4
 #define NO_LPF_HISTORY_YET -12345
 
-class AudioEffectTubeSaturation : public AudioStream
+// entries in the transfer curve table, 512 to 4096
+#ifndef TUBE_TABLE_SIZE
+#define TUBE_TABLE_SIZE 1024
+#endif
+#if TUBE_TABLE_SIZE < 512 || TUBE_TABLE_SIZE > 4096
+#error TUBE_TABLE_SIZE must be 512 to 4096
+#endif
+// the table covers inputs from -TUBE_TABLE_RANGE to TUBE_TABLE_RANGE, beyond that it holds its end values
+#define TUBE_TABLE_RANGE 2.0f
+// entries rebuilt per block after a drive change, the old table stays in use until the new one is done
+#define TUBE_TABLE_BUILD_STEP 256
+
+/*
+   How the saturation curve is evaluated. TubeFormula computes it for every sample. The table modes
+   look it up in a TUBE_TABLE_SIZE table baked for the current drive, interpolated linearly or with a cubic
+   (Catmull-Rom) through four entries, so the cost per sample no longer depends on the curve.
+   Antiderivative antialiasing needs the closed forms, with it on the formula is always used.
+*/
+enum TubeShaper {
+  TubeFormula, TubeTableLinear, TubeTableCubic
+};
+
+class AudioEffectTubeSaturation : public AudioStreamFloat
 {
   public:
-    AudioEffectTubeSaturation() : AudioStream(1, inputQueueArray) {
+    AudioEffectTubeSaturation() : AudioStreamFloat(NUM_CHANNELS, inputQueueArray, NUM_CHANNELS, inputQueueArrayFloat) {
       // any extra initialization
+      for (int c = 0; c < NUM_CHANNELS; ++c) lastLpfSpl[c] = NO_LPF_HISTORY_YET;
     }
     void init(float sampleRate);
     virtual void update(void);
+    virtual void process(float **data);
+
+    void getProfile(EffectProfile &profile) {
+      profiler.snapshot(profile);
+    }
+    void resetProfile(void) {
+      profiler.reset();
+    }
 
     void setDrive(float drive);
     void setMakeupGainDb(float gain);
     void setLpfFrequency(float freq);
+    void setOversampling(int factor);
+    void setAntiderivativeOrder(int order);
+    void setShaper(TubeShaper shaper);
+
+    // added latency in samples, from the oversampling filters and the antiderivative stages
+    int getLatency(void) {
+      return HalfBandOversampler::latency(params.oversampling) + params.antiderivativeOrder / params.oversampling;
+    }
 
   private:
-    audio_block_t *inputQueueArray[1];
+    audio_block_t *inputQueueArray[NUM_CHANNELS];
+    audio_block_float_t *inputQueueArrayFloat[NUM_CHANNELS];
+    EffectProfiler profiler;
 
     float addEvenOrderHarmonics(float x);
-    float saturation(float y0, float y2, float drive);
+    void updateTable(float drive);
+    void saturate(float *data, int n, float drive);
+    void saturateTable(float *data, int n, const float *values, bool cubic);
+    void saturateAntiderivative(float *data, int n, float drive, int channel);
 
     float sampleRate;
 
-    float drive;
-    float makeupGain;
+    // everything update() needs, published as one set by the setters
+    struct Params {
+      float drive;
+      float makeupGain;
+      float alpha;
+      int oversampling = 2;
+      int antiderivativeOrder = 0;
+      TubeShaper shaper = TubeFormula;
+    };
+
+    Params params;
+    ParameterMailbox<Params> mailbox;
 
-    float inSpl, spl;
-    float lastSpl;
+    // the curve at TUBE_TABLE_SIZE points across the range plus one more in front and two behind, so the
+    // cubic always has its four. Audio side only: table is the one in use, the other one is rebuilt when
+    // the drive changes and swapped in once it is complete.
+    float tables[2][TUBE_TABLE_SIZE + 3];
+    float *table = tables[0];
+    bool tableBuilt = false;
+    float tableDrive = 0, buildDrive = 0;
+    int buildIndex = -1;
 
-    float alpha;
-    float lastLpfSpl = NO_LPF_HISTORY_YET;
-    float satSpl, lastSatSpl;
+    // per channel state
+    HalfBandOversampler oversampler[NUM_CHANNELS];
+    AntiderivativeTanh tanhStage[NUM_CHANNELS];
+    float harmonicsHistory[NUM_CHANNELS][2] = {};
+    float lastLpfSpl[NUM_CHANNELS];
+    float lastSatSpl[NUM_CHANNELS] = {};
 
 };
 
@@ -1,66 +1,279 @@
 #include "AudioFilterDenoiser.h"
+#include "CoefficientDesign.h"
 
 void AudioFilterDenoiser::init(float sampleRate) {
   this->sampleRate = sampleRate;
 
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    for (int k = 0; k < BINS; ++k) gain[c][k] = 1;
+    gateGain[c] = 1;
+  }
+
+  // the levels move once per frame
+  params.levelcoef = designTimeCoef(DENOISER_LEVEL_TIME, sampleRate / HOP);
+
   // defaults
+  setMode(DenoiserSpectralExpander);
+  setThresholdDb(6.0);
+  setReductionDb(20.0);
+  setReleaseMs(100.0);
+  setGateThresholdDb(-66.0);
+  setGateHysteresisDb(6.0);
+  setGateHoldMs(50.0);
+  setGateReleaseMs(100.0);
+  setGateRangeDb(DENOISER_GATE_MUTE_DB);
+}
+
+void AudioFilterDenoiser::update(void) {
+  uint32_t profileStart = profiler.start();
+
+  processBlock();
 
+  profiler.stop(profileStart);
 }
 
-#define STEP 0.25;
+void AudioFilterDenoiser::process(float **data) {
+  // pick up any new settings at the block boundary
+  const Params &p = mailbox.read();
 
-void AudioFilterDenoiser::update(void) {
-  // work memory
-  audio_block_t *inBlock;
-  audio_block_t *outBlock;
+  for (int c = 0; c < NUM_CHANNELS; ++c) meter.measureInput(c, data[c]);
+
+  if (p.mode != DenoiserExpander) processSpectral(p, data);
+
+  if (p.mode != DenoiserSpectral) {
+    processExpander(p, data);
+  } else {
+    silent = false;
+    for (int c = 0; c < NUM_CHANNELS; ++c) meter.measureGain(c, 1, 1);
+  }
 
-  inBlock = receiveReadOnly();
-  outBlock = allocate();
+  for (int c = 0; c < NUM_CHANNELS; ++c) meter.measureOutput(c, data[c]);
+  meter.record();
+}
 
-  if (inBlock == NULL || outBlock == NULL) return;
+void AudioFilterDenoiser::processSpectral(const Params &p, float **data) {
 
-  // do the saturation stuff
-  for (int i = 0; i != AUDIO_BLOCK_SAMPLES; ) {
+  // a new capture starts over from an empty sum
+  if (p.captureId != captureId) {
+    captureId = p.captureId;
+    captureFrames = captureFramesLeft = p.captureFrames;
+    for (int c = 0; c < NUM_CHANNELS; ++c) {
+      for (int k = 0; k < BINS; ++k) noiseSum[c][k] = 0;
+    }
+  }
+
+  for (int h = 0; h < AUDIO_BLOCK_SAMPLES; h += HOP) {
+    for (int c = 0; c < NUM_CHANNELS; ++c) processFrame(p, c, data[c] + h, data[c] + h);
+
+    // the capture's last frame, its mean power is the new floor
+    if (captureFramesLeft > 0 && --captureFramesLeft == 0) {
+      float scale = 1.0f / captureFrames;
+      for (int c = 0; c < NUM_CHANNELS; ++c) {
+        for (int k = 0; k < BINS; ++k) noise[c][k] = noiseSum[c][k] * scale;
+      }
+      captured = captureId;
+    }
+  }
+}
+
+/**
+   One peak per block and channel decides whether the gate is open, the gain moves once per block and is
+   ramped across it. An open gate with its gain at 1 leaves the block alone, a closed one at 0 clears it
+   and, once every channel is there, has processBlock() drop it.
+*/
+void AudioFilterDenoiser::processExpander(const Params &p, float **data) {
+  const float nRecip = 1.0f / AUDIO_BLOCK_SAMPLES;
+  bool closed = true;
+
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    float *d = data[c];
+
+    float peak = 0;
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) peak = max(peak, fastAbs(d[i]));
+
+    // opens above the open threshold, stays open down to the close threshold and for the hold time after
+    if (peak > p.openThreshold || (gateOpen[c] && peak >= p.closeThreshold)) {
+      gateOpen[c] = true;
+      holdLeft[c] = p.holdBlocks;
+    } else if (holdLeft[c] > 0) {
+      --holdLeft[c];
+    } else {
+      gateOpen[c] = false;
+    }
+
+    // open within one block, close linearly over the release time
+    float target = gateOpen[c] ? 1 : p.closedGain;
+    float from = gateGain[c];
+    float to = target > from ? target : max(target, from - p.gateReleaseStep);
+    gateGain[c] = to;
+    meter.measureGain(c, from, to);
+
+    if (from == 0 && to == 0) {
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) d[i] = 0;
+      continue;
+    }
+    closed = false;
+    if (from == 1 && to == 1) continue;
+
+    float step = (to - from) * nRecip;
+    float g = from;
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      g += step;
+      d[i] *= g;
+    }
+  }
 
-    // store currrent i
-    int ii = i;
+  silent = closed;
+}
 
-    // calculate mean using bit-shifting and addition
-    int iSpl = inBlock->data[i++] >> 2;
-    iSpl += inBlock->data[i++] >> 2;
-    iSpl += inBlock->data[i++] >> 2;
-    iSpl += inBlock->data[i++] >> 2;
+/**
+   HOP new samples of channel c from in, the HOP samples half a frame behind them to out, which may be in
+*/
+void AudioFilterDenoiser::processFrame(const Params &p, int c, const float *in, float *out) {
+  const float *window = Fft::TABLES.window;
+  float threshold = p.threshold;
+  float floorGain = p.floorGain;
+  float relcoef = p.relcoef;
+  float levelcoef = p.levelcoef;
+  bool capturing = captureFramesLeft > 0;
 
-    float spl = (float)iSpl * INT_TO_FLOAT;
+  // the last HOP samples and the new ones, windowed
+  float frame[FFT_SIZE];
+  float *history = this->history[c];
+  for (int n = 0; n < HOP; ++n) {
+    frame[n] = window[n] * history[n];
+    frame[n + HOP] = window[n + HOP] * in[n];
+    history[n] = in[n];
+  }
 
-    // TODO!
-    float m = spl - lastSpl;
-    float x = 0.0f;
+  float re[BINS], im[BINS];
+  Fft::forward(frame, re, im);
 
-    spl = m * x + lastSpl;
-    outBlock->data[ii++] = (int)(spl * FLOAT_TO_INT);
-    x += STEP;
+  float *noise = this->noise[c];
+  float *noiseSum = this->noiseSum[c];
+  float *level = this->level[c];
+  float *gain = this->gain[c];
+  for (int k = 0; k < BINS; ++k) {
+    float power = re[k] * re[k] + im[k] * im[k];
+    if (capturing) noiseSum[k] += power;
 
-    spl = m * x + lastSpl;
-    outBlock->data[ii++] = (int)(spl * FLOAT_TO_INT);
-    x += STEP;
+    // a single frame's power scatters around the floor, the gate looks at a few frames' worth. It decays
+    // into the denormal range on a silent channel, flush it.
+    float lv = power + levelcoef * (level[k] - power);
+    lv = fastAbs(lv) < C_DENORM ? 0 : lv;
+    level[k] = lv;
 
-    spl = m * x + lastSpl;
-    outBlock->data[ii++] = (int)(spl * FLOAT_TO_INT);
-    x += STEP;
+    // 1 well above the floor, 0.5 at threshold times it, 1 everywhere with no floor captured
+    float over = threshold * noise[k];
+    float g = (lv * lv + C_DENORM) / (lv * lv + over * over + C_DENORM);
+    g = max(g, floorGain);
+    g = g > gain[k] ? g : g + relcoef * (gain[k] - g);
+    g = fastAbs(g) < C_DENORM ? 0 : g;
+    gain[k] = g;
 
-    spl = m * x + lastSpl;
-    outBlock->data[ii++] = (int)(spl * FLOAT_TO_INT);
-    x += STEP;
+    re[k] *= g;
+    im[k] *= g;
+  }
 
-    lastSpl = spl;
+  Fft::inverse(re, im, frame);
 
+  // windowed again and overlapped with the second half of the last frame, flushed like the levels
+  float *overlap = this->overlap[c];
+  for (int n = 0; n < HOP; ++n) {
+    out[n] = overlap[n] + window[n] * frame[n];
+    float o = window[n + HOP] * frame[n + HOP];
+    overlap[n] = fastAbs(o) < C_DENORM ? 0 : o;
   }
+}
 
-  // send the block and release the memory
-  transmit(outBlock);
+/**
+   Learn the noise floor from the next few seconds of input, which should be the noise alone. The gate
+   keeps working with the old floor until the capture is done. Only the spectral modes capture.
+*/
+void AudioFilterDenoiser::captureNoise(float seconds) {
+  params.captureFrames = max(1, (int) (seconds * sampleRate / HOP));
+  ++params.captureId;
+  mailbox.publish(params);
+}
+
+// true from captureNoise() until the new floor is in use
+bool AudioFilterDenoiser::isCapturingNoise(void) {
+  return captured != params.captureId;
+}
+
+/**
+   How far above the noise floor a bin has to be to pass at half its level
+*/
+void AudioFilterDenoiser::setThresholdDb(float thresholdDb) {
+  // the gain compares powers
+  params.threshold = designDbToGain(2 * thresholdDb);
+  mailbox.publish(params);
+}
+
+/**
+   The most a bin is turned down, in dB
+*/
+void AudioFilterDenoiser::setReductionDb(float reductionDb) {
+  params.floorGain = designDbToGain(-reductionDb);
+  mailbox.publish(params);
+}
+
+void AudioFilterDenoiser::setReleaseMs(float mSec) {
+  // the gains move once per frame
+  params.relcoef = designTimeCoef(mSec / 1000, sampleRate / HOP);
+  mailbox.publish(params);
+}
+
+/**
+   DenoiserSpectral and DenoiserSpectralExpander delay the audio by getLatency(), DenoiserExpander doesn't.
+   Switching between them mid stream clicks.
+*/
+void AudioFilterDenoiser::setMode(DenoiserMode mode) {
+  params.mode = mode;
+  mailbox.publish(params);
+}
+
+/**
+   Block peak above which the expander opens
+*/
+void AudioFilterDenoiser::setGateThresholdDb(float thresholdDb) {
+  gateThresh = thresholdDb;
+  setGateThresholds();
+}
+
+/**
+   How far below the open threshold the peak has to fall before the expander starts to close
+*/
+void AudioFilterDenoiser::setGateHysteresisDb(float hysteresisDb) {
+  gateHysteresis = hysteresisDb;
+  setGateThresholds();
+}
+
+void AudioFilterDenoiser::setGateThresholds(void) {
+  params.openThreshold = designDbToGain(gateThresh);
+  params.closeThreshold = designDbToGain(gateThresh - gateHysteresis);
+  mailbox.publish(params);
+}
+
+void AudioFilterDenoiser::setGateHoldMs(float mSec) {
+  params.holdBlocks = (int) (mSec / 1000 * sampleRate / AUDIO_BLOCK_SAMPLES + 0.5f);
+  mailbox.publish(params);
+}
+
+/**
+   Time the expander takes from fully open to fully closed
+*/
+void AudioFilterDenoiser::setGateReleaseMs(float mSec) {
+  // the gain moves once per block
+  params.gateReleaseStep = min(1.0f, AUDIO_BLOCK_SAMPLES / (mSec / 1000 * sampleRate));
+  mailbox.publish(params);
+}
 
-  // need to also release the input block because the library uses reference counting...
-  release(inBlock);
-  release(outBlock);
+/**
+   How far the closed expander turns the signal down, DENOISER_GATE_MUTE_DB or more mutes it, which lets
+   the effects after it skip silent blocks
+*/
+void AudioFilterDenoiser::setGateRangeDb(float rangeDb) {
+  params.closedGain = rangeDb >= DENOISER_GATE_MUTE_DB ? 0 : designDbToGain(-rangeDb);
+  mailbox.publish(params);
 }
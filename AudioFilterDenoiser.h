@@ -3,23 +3,172 @@
 
 #include <Arduino.h>
 #include <AudioStream.h>
-
+#include "AudioStreamFloat.h"
+#include "DynamicsMeter.h"
+#include "EffectProfiler.h"
+#include "ParameterMailbox.h"
 #include "FastMath.h"
+#include "RealFft.h"
+
+// FFT size as a power of two, 7 (128 points) or 8 (256 points), frames overlap by half
+#ifndef DENOISER_FFT_BITS
+#define DENOISER_FFT_BITS 8
+#endif
+
+// smoothing of each bin's power before the gate compares it with the floor
+#define DENOISER_LEVEL_TIME 0.008
+
+// the expander's range from which it mutes
+#define DENOISER_GATE_MUTE_DB 80
+
+static_assert(DENOISER_FFT_BITS == 7 || DENOISER_FFT_BITS == 8, "DENOISER_FFT_BITS must be 7 or 8");
+// process() runs whole hops per block and keeps no partial hop between blocks
+static_assert(AUDIO_BLOCK_SAMPLES % (1 << (DENOISER_FFT_BITS - 1)) == 0,
+              "AUDIO_BLOCK_SAMPLES must be a whole number of denoiser hops");
+
+enum DenoiserMode {
+  DenoiserSpectral, DenoiserExpander, DenoiserSpectralExpander
+};
+
+/*
+   Spectral noise gate.
+
+   Each channel is cut into frames of 2^DENOISER_FFT_BITS samples that overlap by half, windowed with the
+   square root of a Hann window on the way in and again on the way out, so with every gain at 1 the
+   overlapped frames add back up to the input exactly, delayed by half a frame (getLatency()).
+
+   captureNoise() learns the noise floor: the mean power of every bin over the next few frames, played
+   with the instrument silent so it hears the hum and hiss alone. After that, each bin is turned down
+   smoothly as its power, averaged over DENOISER_LEVEL_TIME, sinks towards its floor: by
+   level^2 / (level^2 + (threshold * floor)^2), down to the reduction limit. A bin opens at once and closes
+   with the release time, which keeps the leftover noise from twittering. Until a floor is captured every
+   gain is 1.
 
-class AudioFilterDenoiser : public AudioStream
+   The FFT and every bin's gain run for every frame, whatever the signal, so the cost per block is fixed.
+
+   The expander is a downward gate on each channel's block peak, after the spectral gate in
+   DenoiserSpectralExpander, cheap enough to leave on: it opens above the gate threshold, starts closing
+   once the peak falls the hysteresis below it and the hold time has passed, and closes linearly over its
+   release time down to the range. The gain moves once per block and is ramped linearly across it. Fully
+   closed at a muting range, the block goes nowhere and the effects after the denoiser skip it, or run on
+   silence until they have settled, see AudioStreamFloat::isSettled().
+*/
+class AudioFilterDenoiser : public AudioStreamFloat
 {
   public:
-    AudioFilterDenoiser() : AudioStream(1, inputQueueArray) {
+    static const int FFT_SIZE = 1 << DENOISER_FFT_BITS;
+    static const int HOP = FFT_SIZE / 2;
+    static const int BINS = FFT_SIZE / 2 + 1;
+
+    AudioFilterDenoiser() : AudioStreamFloat(NUM_CHANNELS, inputQueueArray, NUM_CHANNELS, inputQueueArrayFloat) {
       // any extra initialization
     }
     void init(float sampleRate);
     virtual void update(void);
+    virtual void process(float **data);
+
+    void getProfile(EffectProfile &profile) {
+      profiler.snapshot(profile);
+    }
+    void resetProfile(void) {
+      profiler.reset();
+    }
+
+    // levels and the expander's gain of the last block, safe to call from loop() while audio is running
+    void getLevels(DynamicsLevels &levels) {
+      meter.snapshot(levels);
+    }
+
+    void setMode(DenoiserMode mode);
+
+    void captureNoise(float seconds);
+    bool isCapturingNoise(void);
+
+    void setThresholdDb(float thresholdDb);
+    void setReductionDb(float reductionDb);
+    void setReleaseMs(float mSec);
+
+    void setGateThresholdDb(float thresholdDb);
+    void setGateHysteresisDb(float hysteresisDb);
+    void setGateHoldMs(float mSec);
+    void setGateReleaseMs(float mSec);
+    void setGateRangeDb(float rangeDb);
+
+    // added latency in samples, half a frame in the spectral modes
+    int getLatency(void) {
+      return params.mode == DenoiserExpander ? 0 : HOP;
+    }
+
+  protected:
+    virtual bool silentOutput(void) {
+      return silent;
+    }
 
   private:
-    audio_block_t *inputQueueArray[1];
+    typedef RealFft<DENOISER_FFT_BITS> Fft;
+
+    audio_block_t *inputQueueArray[NUM_CHANNELS];
+    audio_block_float_t *inputQueueArrayFloat[NUM_CHANNELS];
+    EffectProfiler profiler;
+    DynamicsMeter meter;
 
     float sampleRate;
-    float lastSpl;
+
+    // from controls
+    float gateThresh = 0;
+    float gateHysteresis = 0;
+
+    // everything update() needs, published as one set by the setters. The defaults pass the audio through
+    // untouched, for whatever a setter publishes before init() has filled in the rest.
+    struct Params {
+      DenoiserMode mode = DenoiserSpectralExpander;
+
+      float threshold = 0;
+      float floorGain = 1;
+      float relcoef = 0;
+      float levelcoef = 0;
+
+      // a new captureId starts a capture of captureFrames frames
+      uint32_t captureId = 0;
+      int captureFrames = 0;
+
+      float openThreshold = 0, closeThreshold = 0;
+      int holdBlocks = 0;
+      float gateReleaseStep = 1;
+      float closedGain = 1;
+    };
+
+    void setGateThresholds(void);
+
+    void processSpectral(const Params &p, float **data);
+    void processFrame(const Params &p, int c, const float *in, float *out);
+    void processExpander(const Params &p, float **data);
+
+    Params params;
+    ParameterMailbox<Params> mailbox;
+
+    // the captureId of the last finished capture, written by update()
+    volatile uint32_t captured = 0;
+
+    // capture in progress, audio side
+    uint32_t captureId = 0;
+    int captureFramesLeft = 0;
+    int captureFrames = 0;
+    float noiseSum[NUM_CHANNELS][BINS] = {};
+
+    // per channel noise floor, bin levels and gains, and overlap state
+    float noise[NUM_CHANNELS][BINS] = {};
+    float level[NUM_CHANNELS][BINS] = {};
+    float gain[NUM_CHANNELS][BINS];
+    float history[NUM_CHANNELS][HOP] = {};
+    float overlap[NUM_CHANNELS][HOP] = {};
+
+    // per channel expander state, its gain starts at 1 so the first blocks go through
+    bool gateOpen[NUM_CHANNELS] = {};
+    int holdLeft[NUM_CHANNELS] = {};
+    float gateGain[NUM_CHANNELS];
+    // every channel of the last block came out muted
+    bool silent = false;
 };
 
 #endif /* _AUDIO_FILTER_DENOISER_H */
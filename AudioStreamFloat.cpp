@@ -0,0 +1,237 @@
+#include <string.h>
+
+#include "AudioStreamFloat.h"
+
+audio_block_float_t *AudioStreamFloat::memory_free_float = NULL;
+uint16_t AudioStreamFloat::memory_used_float = 0;
+uint16_t AudioStreamFloat::memory_used_float_max = 0;
+
+AudioStreamFloat::AudioStreamFloat(unsigned char ninput, audio_block_t **iqueue,
+                                   unsigned char nfloat, audio_block_float_t **fqueue) :
+  AudioStream(ninput, iqueue), num_inputs_float(nfloat), inputQueueFloat(fqueue), destination_list_float(NULL) {
+
+  for (int i = 0; i < num_inputs_float; ++i) inputQueueFloat[i] = NULL;
+}
+
+AudioConnectionFloat::AudioConnectionFloat(AudioStreamFloat &source, AudioStreamFloat &destination) :
+  AudioConnectionFloat(source, 0, destination, 0) {
+}
+
+AudioConnectionFloat::AudioConnectionFloat(AudioStreamFloat &source, unsigned char sourceOutput,
+    AudioStreamFloat &destination, unsigned char destinationInput) :
+  src(source), dst(destination), src_index(sourceOutput), dest_index(destinationInput), next_dest(NULL) {
+
+  if (source.destination_list_float == NULL) {
+    source.destination_list_float = this;
+  } else {
+    AudioConnectionFloat *p = source.destination_list_float;
+    while (p->next_dest) p = p->next_dest;
+    p->next_dest = this;
+  }
+
+  // only connected streams get updated
+  source.active = true;
+  destination.active = true;
+}
+
+void AudioStreamFloat::initialize_memory(audio_block_float_t *data, unsigned int num) {
+  memory_free_float = NULL;
+  for (unsigned int i = num; i > 0; --i) {
+    audio_block_float_t *block = data + i - 1;
+    block->ref_count = 0;
+    block->memory_pool_index = i - 1;
+    *(audio_block_float_t**)block->data = memory_free_float;
+    memory_free_float = block;
+  }
+  memory_used_float = 0;
+  memory_used_float_max = 0;
+}
+
+audio_block_float_t *AudioStreamFloat::allocateFloat(void) {
+  audio_block_float_t *block = memory_free_float;
+  if (block == NULL) return NULL;
+
+  memory_free_float = *(audio_block_float_t**)block->data;
+  block->ref_count = 1;
+  if (++memory_used_float > memory_used_float_max) memory_used_float_max = memory_used_float;
+  return block;
+}
+
+void AudioStreamFloat::releaseFloat(audio_block_float_t *block) {
+  if (block == NULL) return;
+
+  if (block->ref_count > 1) {
+    --block->ref_count;
+  } else {
+    block->ref_count = 0;
+    *(audio_block_float_t**)block->data = memory_free_float;
+    memory_free_float = block;
+    --memory_used_float;
+  }
+}
+
+void AudioStreamFloat::transmitFloat(audio_block_float_t *block, unsigned char index) {
+  for (AudioConnectionFloat *c = destination_list_float; c != NULL; c = c->next_dest) {
+    if (c->src_index == index && c->dst.inputQueueFloat[c->dest_index] == NULL) {
+      c->dst.inputQueueFloat[c->dest_index] = block;
+      ++block->ref_count;
+    }
+  }
+}
+
+audio_block_float_t *AudioStreamFloat::receiveReadOnlyFloat(unsigned int index) {
+  if (index >= num_inputs_float) return NULL;
+
+  audio_block_float_t *in = inputQueueFloat[index];
+  inputQueueFloat[index] = NULL;
+  return in;
+}
+
+audio_block_float_t *AudioStreamFloat::receiveWritableFloat(unsigned int index) {
+  audio_block_float_t *in = receiveReadOnlyFloat(index);
+
+  // shared with another input, work on a copy
+  if (in && in->ref_count > 1) {
+    audio_block_float_t *p = allocateFloat();
+    if (p) memcpy(p->data, in->data, sizeof(p->data));
+    --in->ref_count;
+    in = p;
+  }
+  return in;
+}
+
+void AudioStreamFloat::convertToFloat(const int16_t *in, float *out) {
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+    out[i] = (float)in[i] * INT_TO_FLOAT;
+  }
+}
+
+void AudioStreamFloat::convertToInt(const float *in, int16_t *out) {
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+    float spl = in[i] * FLOAT_TO_INT;
+    out[i] = spl > 32767.0f ? 32767 : (spl < -32768.0f ? -32768 : (int)spl);
+  }
+}
+
+void AudioStreamFloat::processBlock(void) {
+  audio_block_float_t *floatBlock[NUM_CHANNELS];
+  audio_block_t *inBlock[NUM_CHANNELS];
+  float *data[NUM_CHANNELS];
+  bool received = false;
+
+  // work memory for channels that arrived as int16 or not at all
+  float spl[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    floatBlock[c] = receiveWritableFloat(c);
+    inBlock[c] = floatBlock[c] == NULL ? receiveReadOnly(c) : NULL;
+
+    if (floatBlock[c] != NULL) {
+      data[c] = floatBlock[c]->data;
+      lastKind[c] = FloatBlock;
+    } else {
+      data[c] = spl[c];
+      if (inBlock[c] != NULL) {
+        convertToFloat(inBlock[c]->data, spl[c]);
+        lastKind[c] = IntBlock;
+      } else {
+        memset(spl[c], 0, sizeof(spl[c]));
+      }
+    }
+    received |= floatBlock[c] != NULL || inBlock[c] != NULL;
+  }
+
+  if (!received) {
+    if (!isSettled()) processSilence(data);
+    return;
+  }
+
+#if FIXED_POINT_DSP
+  bool anyFloat = false;
+  for (int c = 0; c < NUM_CHANNELS; ++c) anyFloat |= floatBlock[c] != NULL;
+  if (!anyFloat && processBlockFixed(inBlock)) return;
+#endif
+
+  process(data);
+  bool silent = silentOutput();
+
+  // send each channel back out the way it came in and release the memory
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    if (floatBlock[c] != NULL) {
+      if (!silent) transmitFloat(floatBlock[c], c);
+      releaseFloat(floatBlock[c]);
+    } else if (inBlock[c] != NULL) {
+      audio_block_t *outBlock = silent ? NULL : allocate();
+      if (outBlock != NULL) {
+        convertToInt(spl[c], outBlock->data);
+        transmit(outBlock, c);
+        release(outBlock);
+      }
+
+      // need to also release the input block because the library uses reference counting...
+      release(inBlock[c]);
+    }
+  }
+}
+
+/**
+   process() on a block of silence for an effect that hasn't settled, whose input went quiet upstream.
+   The result goes out the way each channel last came in.
+*/
+void AudioStreamFloat::processSilence(float **data) {
+  process(data);
+  if (silentOutput()) return;
+
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    if (lastKind[c] == FloatBlock) {
+      audio_block_float_t *outBlock = allocateFloat();
+      if (outBlock != NULL) {
+        memcpy(outBlock->data, data[c], sizeof(outBlock->data));
+        transmitFloat(outBlock, c);
+        releaseFloat(outBlock);
+      }
+    } else if (lastKind[c] == IntBlock) {
+      audio_block_t *outBlock = allocate();
+      if (outBlock != NULL) {
+        convertToInt(data[c], outBlock->data);
+        transmit(outBlock, c);
+        release(outBlock);
+      }
+    }
+  }
+}
+
+#if FIXED_POINT_DSP
+/**
+   Run processFixed() on int16 blocks, send the results and release the inputs. False if the effect
+   declined, the input blocks are left for the float path then.
+*/
+bool AudioStreamFloat::processBlockFixed(audio_block_t **inBlock) {
+  int16_t spl[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+  int16_t *data[NUM_CHANNELS];
+
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    data[c] = spl[c];
+    if (inBlock[c] != NULL) {
+      memcpy(spl[c], inBlock[c]->data, sizeof(spl[c]));
+    } else {
+      memset(spl[c], 0, sizeof(spl[c]));
+    }
+  }
+
+  if (!processFixed(data)) return false;
+
+  for (int c = 0; c < NUM_CHANNELS; ++c) {
+    if (inBlock[c] == NULL) continue;
+
+    audio_block_t *outBlock = allocate();
+    if (outBlock != NULL) {
+      memcpy(outBlock->data, spl[c], sizeof(outBlock->data));
+      transmit(outBlock, c);
+      release(outBlock);
+    }
+    release(inBlock[c]);
+  }
+  return true;
+}
+#endif
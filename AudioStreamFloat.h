@@ -0,0 +1,122 @@
+#ifndef _AUDIO_STREAM_FLOAT_H
+#define _AUDIO_STREAM_FLOAT_H
+
+#include <Arduino.h>
+#include <AudioStream.h>
+
+#include "FastMath.h"
+#include "FixedPoint.h"
+
+/*
+   Float blocks passed between effects so a chain only converts to and from int16 at its ends.
+
+   Effects deriving from AudioStreamFloat keep their normal int16 input as well. processBlock() takes
+   whichever kind of block arrived, runs process() on it as float and sends the result out the same way,
+   so an effect works in both an AudioConnection and an AudioConnectionFloat patch.
+
+   Effects have NUM_CHANNELS inputs and outputs, channel n comes in on input n and goes out on output n.
+   process() gets all channels of a block at once, so one object handles a whole multichannel rig.
+
+   With FIXED_POINT_DSP, a block where every channel arrived as int16 is offered to processFixed() first,
+   and only converted to float when the effect has no fixed point path for it.
+
+   Float blocks come from their own pool, see AudioMemoryFloat(). The pool is only touched from update(),
+   which never preempts itself, so unlike the int16 pool it needs no interrupt locking.
+*/
+
+typedef struct audio_block_float_struct {
+  uint8_t ref_count;
+  uint8_t reserved1;
+  uint16_t memory_pool_index;
+  float data[AUDIO_BLOCK_SAMPLES];
+} audio_block_float_t;
+
+#define AudioMemoryFloat(num) ({ \
+    static audio_block_float_t data[num]; \
+    AudioStreamFloat::initialize_memory(data, num); \
+  })
+
+class AudioStreamFloat;
+
+class AudioConnectionFloat {
+  public:
+    AudioConnectionFloat(AudioStreamFloat &source, AudioStreamFloat &destination);
+    AudioConnectionFloat(AudioStreamFloat &source, unsigned char sourceOutput,
+                         AudioStreamFloat &destination, unsigned char destinationInput);
+
+  private:
+    AudioStreamFloat &src;
+    AudioStreamFloat &dst;
+    unsigned char src_index;
+    unsigned char dest_index;
+    AudioConnectionFloat *next_dest;
+
+    friend class AudioStreamFloat;
+};
+
+class AudioStreamFloat : public AudioStream {
+  public:
+    AudioStreamFloat(unsigned char ninput, audio_block_t **iqueue, unsigned char nfloat, audio_block_float_t **fqueue);
+
+    static void initialize_memory(audio_block_float_t *data, unsigned int num);
+
+    static void convertToFloat(const int16_t *in, float *out);
+    // saturates instead of wrapping around
+    static void convertToInt(const float *in, int16_t *out);
+
+    static uint16_t memory_used_float;
+    static uint16_t memory_used_float_max;
+
+  protected:
+    static audio_block_float_t *allocateFloat(void);
+    static void releaseFloat(audio_block_float_t *block);
+    void transmitFloat(audio_block_float_t *block, unsigned char index = 0);
+    audio_block_float_t *receiveReadOnlyFloat(unsigned int index = 0);
+    audio_block_float_t *receiveWritableFloat(unsigned int index = 0);
+
+    // receive, process() and transmit one block per channel, in whichever format each arrived
+    void processBlock(void);
+    // data holds NUM_CHANNELS blocks, a channel with nothing connected is silence
+    virtual void process(float **data) {}
+    // true if the block process() just ran came out as silence on every channel. It is then not sent on
+    // and the effects downstream get no input, see isSettled().
+    virtual bool silentOutput(void) {
+      return false;
+    }
+    // true if silence would leave the effect as it is and come out as silence, so a block that doesn't
+    // arrive can be skipped. An effect whose state keeps moving on silence, a compressor releasing, returns
+    // false until it has settled, and process() runs on silence instead of the missing blocks until then.
+    virtual bool isSettled(void) {
+      return true;
+    }
+
+#if FIXED_POINT_DSP
+    // same for int16 blocks, processed in place. Returns false to have the block run through process().
+    virtual bool processFixed(int16_t **data) {
+      return false;
+    }
+#endif
+
+  private:
+    void processSilence(float **data);
+#if FIXED_POINT_DSP
+    bool processBlockFixed(audio_block_t **inBlock);
+#endif
+
+    // how each channel last arrived, the blocks an unsettled effect makes up go out the same way
+    enum BlockKind {
+      NoBlock, IntBlock, FloatBlock
+    };
+    uint8_t lastKind[NUM_CHANNELS] = {};
+
+    unsigned char num_inputs_float;
+    audio_block_float_t **inputQueueFloat;
+    AudioConnectionFloat *destination_list_float;
+
+    // free blocks are chained through their first bytes, so the pool needs no bookkeeping array
+    static audio_block_float_t *memory_free_float;
+
+    friend class AudioConnectionFloat;
+};
+
+#endif /* _AUDIO_STREAM_FLOAT_H */
@@ -0,0 +1,147 @@
+#ifndef _BIQUAD_CASCADE_H
+#define _BIQUAD_CASCADE_H
+
+#include <Arduino.h>
+#include <AudioStream.h>
+
+#include "FastMath.h"
+
+/*
+   Normalized (a0 == 1) coefficients for every section of a cascade, one array per coefficient.
+   Kept apart from the filter state so a whole set can be handed over through a ParameterMailbox.
+*/
+template <int SECTIONS>
+struct BiquadCoefficients {
+  float b0[SECTIONS], b1[SECTIONS], b2[SECTIONS], a1[SECTIONS], a2[SECTIONS];
+
+  BiquadCoefficients() {
+    for (int s = 0; s < SECTIONS; ++s) setSection(s, 1, 0, 0, 0, 0);
+  }
+
+  void setSection(int s, float b0, float b1, float b2, float a1, float a2) {
+    this->b0[s] = b0;
+    this->b1[s] = b1;
+    this->b2[s] = b2;
+    this->a1[s] = a1;
+    this->a2[s] = a2;
+  }
+};
+
+/*
+   Cascade of transposed direct form II biquad sections with the state kept in arrays.
+
+   Two state values per section instead of the four of direct form I, so half the loads and stores at
+   the block edges and a shorter dependency chain inside the loop. Sections are run one at a time over a
+   whole block, so each inner loop only needs its own five coefficients and two state values in registers.
+
+   The state is flushed to zero at the end of every block once it falls below C_DENORM, so a decaying
+   tail never reaches the denormal range whether or not the FPU flushes them itself.
+
+   CHANNELS channels share the coefficients. Their state sits side by side and every sample is run for
+   all channels before the next, so the channels' independent chains overlap in the FPU pipeline.
+*/
+template <int SECTIONS, int CHANNELS = 1>
+class BiquadCascade {
+  public:
+    BiquadCascade() {
+      for (int s = 0; s < SECTIONS; ++s) reset(s);
+    }
+
+    void reset(int s) {
+      for (int ch = 0; ch < CHANNELS; ++ch) s1[s][ch] = s2[s][ch] = 0;
+    }
+
+    // filter AUDIO_BLOCK_SAMPLES of every channel in place through section s
+    void processSection(int s, const BiquadCoefficients<SECTIONS> &c, float **data) {
+      float b0 = c.b0[s];
+      float b1 = c.b1[s];
+      float b2 = c.b2[s];
+      float a1 = c.a1[s];
+      float a2 = c.a2[s];
+
+      float *d[CHANNELS];
+      float s1[CHANNELS], s2[CHANNELS];
+      for (int ch = 0; ch < CHANNELS; ++ch) {
+        d[ch] = data[ch];
+        s1[ch] = this->s1[s][ch];
+        s2[ch] = this->s2[s][ch];
+      }
+
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+        for (int ch = 0; ch < CHANNELS; ++ch) {
+          float x = d[ch][i];
+          float y = b0 * x + s1[ch];
+          s1[ch] = b1 * x - a1 * y + s2[ch];
+          s2[ch] = b2 * x - a2 * y;
+          d[ch][i] = y;
+        }
+      }
+
+      for (int ch = 0; ch < CHANNELS; ++ch) {
+        this->s1[s][ch] = flushDenormal(s1[ch]);
+        this->s2[s][ch] = flushDenormal(s2[ch]);
+      }
+    }
+
+    /*
+       Same as processSection() but the coefficients move linearly from one set to the other across the
+       block. The stable (a1, a2) region is a triangle, so every step between two stable sections is stable.
+    */
+    void processSectionRamp(int s, const BiquadCoefficients<SECTIONS> &from, const BiquadCoefficients<SECTIONS> &to,
+                            float **data) {
+      const float step = 1.0f / AUDIO_BLOCK_SAMPLES;
+
+      float b0 = from.b0[s];
+      float b1 = from.b1[s];
+      float b2 = from.b2[s];
+      float a1 = from.a1[s];
+      float a2 = from.a2[s];
+      float db0 = (to.b0[s] - b0) * step;
+      float db1 = (to.b1[s] - b1) * step;
+      float db2 = (to.b2[s] - b2) * step;
+      float da1 = (to.a1[s] - a1) * step;
+      float da2 = (to.a2[s] - a2) * step;
+
+      float *d[CHANNELS];
+      float s1[CHANNELS], s2[CHANNELS];
+      for (int ch = 0; ch < CHANNELS; ++ch) {
+        d[ch] = data[ch];
+        s1[ch] = this->s1[s][ch];
+        s2[ch] = this->s2[s][ch];
+      }
+
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+        b0 += db0;
+        b1 += db1;
+        b2 += db2;
+        a1 += da1;
+        a2 += da2;
+
+        for (int ch = 0; ch < CHANNELS; ++ch) {
+          float x = d[ch][i];
+          float y = b0 * x + s1[ch];
+          s1[ch] = b1 * x - a1 * y + s2[ch];
+          s2[ch] = b2 * x - a2 * y;
+          d[ch][i] = y;
+        }
+      }
+
+      for (int ch = 0; ch < CHANNELS; ++ch) {
+        this->s1[s][ch] = flushDenormal(s1[ch]);
+        this->s2[s][ch] = flushDenormal(s2[ch]);
+      }
+    }
+
+    void process(const BiquadCoefficients<SECTIONS> &c, float **data) {
+      for (int s = 0; s < SECTIONS; ++s) processSection(s, c, data);
+    }
+
+  private:
+    static float flushDenormal(float x) {
+      return fastAbs(x) < C_DENORM ? 0 : x;
+    }
+
+    float s1[SECTIONS][CHANNELS], s2[SECTIONS][CHANNELS];
+};
+
+#endif /* _BIQUAD_CASCADE_H */
@@ -0,0 +1,166 @@
+#ifndef _BIQUAD_CASCADE_FIXED_H
+#define _BIQUAD_CASCADE_FIXED_H
+
+#include <Arduino.h>
+#include <AudioStream.h>
+
+#include "BiquadCascade.h"
+#include "FixedPoint.h"
+
+/*
+   BiquadCoefficients rounded to FIXED_COEF_BITS, set section by section from the float design.
+*/
+template <int SECTIONS>
+struct BiquadCoefficientsFixed {
+  int32_t b0[SECTIONS], b1[SECTIONS], b2[SECTIONS], a1[SECTIONS], a2[SECTIONS];
+
+  BiquadCoefficientsFixed() {
+    for (int s = 0; s < SECTIONS; ++s) {
+      b0[s] = 1 << FIXED_COEF_BITS;
+      b1[s] = b2[s] = a1[s] = a2[s] = 0;
+    }
+  }
+
+  void setSection(int s, const BiquadCoefficients<SECTIONS> &c) {
+    b0[s] = floatToFixed(c.b0[s], FIXED_COEF_BITS);
+    b1[s] = floatToFixed(c.b1[s], FIXED_COEF_BITS);
+    b2[s] = floatToFixed(c.b2[s], FIXED_COEF_BITS);
+    a1[s] = floatToFixed(c.a1[s], FIXED_COEF_BITS);
+    a2[s] = floatToFixed(c.a2[s], FIXED_COEF_BITS);
+  }
+};
+
+/*
+   Fixed point version of BiquadCascade, on samples in the FixedPoint.h format.
+
+   Direct form I rather than the float cascade's transposed form II: the state is the last two inputs and
+   outputs, which are plain samples and need no extra bits, and the whole difference equation sums in one
+   64 bit accumulator so there is a single rounding per sample. The bits that rounding drops are added
+   back into the next sample (first order error feedback), which keeps low frequency sections with poles
+   close to the unit circle from growing a noise floor or limit cycles. Integer state never goes denormal.
+   Outputs past the headroom clip at FIXED_SAMPLE_MAX rather than wrap into the state and the next section.
+
+   Same section at a time, channels side by side layout as BiquadCascade.
+*/
+template <int SECTIONS, int CHANNELS = 1>
+class BiquadCascadeFixed {
+  public:
+    BiquadCascadeFixed() {
+      for (int s = 0; s < SECTIONS; ++s) reset(s);
+    }
+
+    void reset(int s) {
+      for (int ch = 0; ch < CHANNELS; ++ch) x1[s][ch] = x2[s][ch] = y1[s][ch] = y2[s][ch] = error[s][ch] = 0;
+    }
+
+    // filter AUDIO_BLOCK_SAMPLES of every channel in place through section s
+    void processSection(int s, const BiquadCoefficientsFixed<SECTIONS> &c, int32_t **data) {
+      int32_t b0 = c.b0[s];
+      int32_t b1 = c.b1[s];
+      int32_t b2 = c.b2[s];
+      int32_t a1 = c.a1[s];
+      int32_t a2 = c.a2[s];
+
+      int32_t *d[CHANNELS];
+      int32_t x1[CHANNELS], x2[CHANNELS], y1[CHANNELS], y2[CHANNELS];
+      uint32_t error[CHANNELS];
+      load(s, data, d, x1, x2, y1, y2, error);
+
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+        for (int ch = 0; ch < CHANNELS; ++ch) {
+          int32_t x = d[ch][i];
+          int64_t acc = (int64_t) b0 * x + (int64_t) b1 * x1[ch] + (int64_t) b2 * x2[ch]
+                        - (int64_t) a1 * y1[ch] - (int64_t) a2 * y2[ch] + error[ch];
+          int32_t y = saturateSample(acc >> FIXED_COEF_BITS);
+          error[ch] = (uint32_t) acc & COEF_MASK;
+          x2[ch] = x1[ch];
+          x1[ch] = x;
+          y2[ch] = y1[ch];
+          y1[ch] = y;
+          d[ch][i] = y;
+        }
+      }
+
+      store(s, x1, x2, y1, y2, error);
+    }
+
+    /*
+       Same as processSection() but the coefficients move linearly from one set to the other across the
+       block, as in BiquadCascade::processSectionRamp().
+    */
+    void processSectionRamp(int s, const BiquadCoefficientsFixed<SECTIONS> &from,
+                            const BiquadCoefficientsFixed<SECTIONS> &to, int32_t **data) {
+      int32_t b0 = from.b0[s];
+      int32_t b1 = from.b1[s];
+      int32_t b2 = from.b2[s];
+      int32_t a1 = from.a1[s];
+      int32_t a2 = from.a2[s];
+      int32_t db0 = (to.b0[s] - b0) >> FIXED_BLOCK_SHIFT;
+      int32_t db1 = (to.b1[s] - b1) >> FIXED_BLOCK_SHIFT;
+      int32_t db2 = (to.b2[s] - b2) >> FIXED_BLOCK_SHIFT;
+      int32_t da1 = (to.a1[s] - a1) >> FIXED_BLOCK_SHIFT;
+      int32_t da2 = (to.a2[s] - a2) >> FIXED_BLOCK_SHIFT;
+
+      int32_t *d[CHANNELS];
+      int32_t x1[CHANNELS], x2[CHANNELS], y1[CHANNELS], y2[CHANNELS];
+      uint32_t error[CHANNELS];
+      load(s, data, d, x1, x2, y1, y2, error);
+
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+        b0 += db0;
+        b1 += db1;
+        b2 += db2;
+        a1 += da1;
+        a2 += da2;
+
+        for (int ch = 0; ch < CHANNELS; ++ch) {
+          int32_t x = d[ch][i];
+          int64_t acc = (int64_t) b0 * x + (int64_t) b1 * x1[ch] + (int64_t) b2 * x2[ch]
+                        - (int64_t) a1 * y1[ch] - (int64_t) a2 * y2[ch] + error[ch];
+          int32_t y = saturateSample(acc >> FIXED_COEF_BITS);
+          error[ch] = (uint32_t) acc & COEF_MASK;
+          x2[ch] = x1[ch];
+          x1[ch] = x;
+          y2[ch] = y1[ch];
+          y1[ch] = y;
+          d[ch][i] = y;
+        }
+      }
+
+      store(s, x1, x2, y1, y2, error);
+    }
+
+  private:
+    static const uint32_t COEF_MASK = (1u << FIXED_COEF_BITS) - 1;
+
+    // copy from class state
+    void load(int s, int32_t **data, int32_t **d, int32_t *x1, int32_t *x2, int32_t *y1, int32_t *y2,
+              uint32_t *error) {
+      for (int ch = 0; ch < CHANNELS; ++ch) {
+        d[ch] = data[ch];
+        x1[ch] = this->x1[s][ch];
+        x2[ch] = this->x2[s][ch];
+        y1[ch] = this->y1[s][ch];
+        y2[ch] = this->y2[s][ch];
+        error[ch] = this->error[s][ch];
+      }
+    }
+
+    // copy back to class state
+    void store(int s, const int32_t *x1, const int32_t *x2, const int32_t *y1, const int32_t *y2,
+               const uint32_t *error) {
+      for (int ch = 0; ch < CHANNELS; ++ch) {
+        this->x1[s][ch] = x1[ch];
+        this->x2[s][ch] = x2[ch];
+        this->y1[s][ch] = y1[ch];
+        this->y2[s][ch] = y2[ch];
+        this->error[s][ch] = error[ch];
+      }
+    }
+
+    int32_t x1[SECTIONS][CHANNELS], x2[SECTIONS][CHANNELS];
+    int32_t y1[SECTIONS][CHANNELS], y2[SECTIONS][CHANNELS];
+    uint32_t error[SECTIONS][CHANNELS];
+};
+
+#endif /* _BIQUAD_CASCADE_FIXED_H */
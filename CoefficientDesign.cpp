@@ -0,0 +1,90 @@
+#include "CoefficientDesign.h"
+
+/*
+   ln(2) and pi / 2 split Cody-Waite style, the high parts with their last 12 bits clear so n * HI is
+   exact for any n the range reduction can produce.
+*/
+#define LN_2_HI 6.931152344e-01f  // 0x3f317000
+#define LN_2_LO 3.194618330e-05f
+#define HALF_PI_HI 1.570312500e+00f  // 0x3fc90000
+#define HALF_PI_LO 4.838267923e-04f
+
+// round to nearest, half away from zero
+static inline int roundToInt(float x) {
+  return (int) (x + (x < 0 ? -0.5f : 0.5f));
+}
+
+/**
+   x = n ln(2) + r with |r| <= ln(2) / 2, then 2^n e^r. e^r is 1 + r + r^2 P(r), P a degree 4 minimax fit
+   to 4e-9 relative, so small r keeps the leading terms exact.
+*/
+float designExp(float x) {
+  // keeps n in range of an int and the result in range of the clamp below
+  x = x < -87.0f ? -87.0f : (x > 88.0f ? 88.0f : x);
+  int n = roundToInt(x * LOG2_E);
+  float r = (x - n * LN_2_HI) - n * LN_2_LO;
+  float p = 1.381461276e-03f;
+  p = p * r + 8.368710056e-03f;
+  p = p * r + 4.166838899e-02f;
+  p = p * r + 1.666652113e-01f;
+  p = p * r + 4.999999404e-01f;
+  float e = 1 + (r + r * r * p);
+
+  n = n < -125 ? -125 : (n > 127 ? 127 : n);
+  uint32_t bits = *(uint32_t*)&e;
+  bits += (uint32_t) n << 23;
+  return *(float*)&bits;
+}
+
+float designDbToGain(float db) {
+  return designExp(db * (float) DB_TO_LOG);
+}
+
+float designTimeCoef(float time, float sampleRate) {
+  return designExp(-1 / (time * sampleRate));
+}
+
+float designPoleCoef(float freq, float sampleRate) {
+  return designExp(-(float) TWO_PI * freq / sampleRate);
+}
+
+/**
+   w = q pi / 2 + r with |r| <= pi / 4, the quadrant q picks which of sin(r) and cos(r) goes where.
+   sin(r) = r + r^3 S(r^2) and cos(r) = 1 - r^2 / 2 + r^4 C(r^2), both minimax to 2e-9.
+*/
+void designSinCos(float w, float &sinW, float &cosW) {
+  int q = roundToInt(w * (float) (2 / PI));
+  float r = (w - q * HALF_PI_HI) - q * HALF_PI_LO;
+  float r2 = r * r;
+
+  float s = r + r * r2 * (-1.666665077e-01f + r2 * (8.331978694e-03f + r2 * -1.949563593e-04f));
+  float c = 1 - 0.5f * r2 + r2 * r2 * (4.166664556e-02f + r2 * (-1.388736768e-03f + r2 * 2.443845187e-05f));
+
+  switch (q & 3) {
+    case 0:
+      sinW = s;
+      cosW = c;
+      break;
+    case 1:
+      sinW = c;
+      cosW = -s;
+      break;
+    case 2:
+      sinW = -s;
+      cosW = -c;
+      break;
+    default:
+      sinW = -c;
+      cosW = s;
+      break;
+  }
+}
+
+/**
+   sin(w / 2) / cos(w / 2), cos only gets small right at Nyquist.
+*/
+float designTanHalf(float w) {
+  float s, c;
+  designSinCos(0.5f * w, s, c);
+  return s / c;
+}
@@ -0,0 +1,41 @@
+#ifndef _COEFFICIENT_DESIGN_H
+#define _COEFFICIENT_DESIGN_H
+
+#include <Arduino.h>
+
+#include "FastMath.h"
+
+/*
+   exp, dB and trig for filter and envelope coefficients, without libm.
+
+   The FastMath approximations are too rough for coefficients: fastExp() is 0.2% off, so a one pole
+   smoothing coefficient of 0.9999 comes out above 1, and a biquad's cos(w0) has to be good to well under
+   a part per million at low frequencies. These are minimax polynomials after an exact range reduction, to
+   within a few float roundings over the whole range (3e-7 relative for exp, 1e-7 absolute for sin and
+   cos). 0 dB is exactly 1 and a time constant coefficient keeps every digit of 1 - coef.
+
+   The setters used to call libm in double, which the Teensy's FPU can't do, so every exp, pow, sin and cos
+   there was a software double precision routine. These are a couple of dozen single precision operations,
+   so setters can run every block, from an LFO or an envelope, rather than only when a knob moves. On the
+   host, where libm is fast, they cost about the same as expf() and half of pow() or sin() plus cos().
+*/
+
+// e^x, saturating at e^-87 and e^88
+float designExp(float x);
+
+// 10^(db / 20), dB to linear gain
+float designDbToGain(float db);
+
+// exp(-1 / (time * sampleRate)), the one pole smoothing coefficient for a time constant in seconds
+float designTimeCoef(float time, float sampleRate);
+
+// exp(-2 pi freq / sampleRate), the feedback coefficient of a one pole low pass at freq
+float designPoleCoef(float freq, float sampleRate);
+
+// sin and cos of w, any w, good to 1e-7 within a few thousand half turns
+void designSinCos(float w, float &sinW, float &cosW);
+
+// tan(w / 2), the prewarped frequency of the bilinear and state variable designs, w below pi
+float designTanHalf(float w);
+
+#endif /* _COEFFICIENT_DESIGN_H */
@@ -0,0 +1,56 @@
+#include "DynamicsMeter.h"
+
+void DynamicsMeter::measure(const float *x, float &peak, float &rms) {
+  float maxAbs = 0, sum = 0;
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+    maxAbs = max(maxAbs, fastAbs(x[i]));
+    sum += x[i] * x[i];
+  }
+  peak = maxAbs;
+  rms = fastSqrt(sum * (1.0f / AUDIO_BLOCK_SAMPLES));
+}
+
+#if FIXED_POINT_DSP
+void DynamicsMeter::measure(const int16_t *x, float &peak, float &rms) {
+  int32_t maxAbs = 0;
+  int64_t sum = 0;
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+    int32_t spl = x[i];
+    maxAbs = max(maxAbs, abs(spl));
+    sum += spl * spl;
+  }
+  peak = maxAbs * INT_TO_FLOAT;
+  rms = fastSqrt((float) sum * (1.0f / AUDIO_BLOCK_SAMPLES)) * INT_TO_FLOAT;
+}
+#endif
+
+void DynamicsMeter::measureGain(int c, const float *gain) {
+  float minGain = gain[0], sum = 0;
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+    minGain = min(minGain, gain[i]);
+    sum += gain[i];
+  }
+  staged.minGain[c] = minGain;
+  staged.meanGain[c] = sum * (1.0f / AUDIO_BLOCK_SAMPLES);
+}
+
+void DynamicsMeter::record(void) {
+  ++sequence;
+  __sync_synchronize();
+  published = staged;
+  published.blocks = ++blocks;
+  __sync_synchronize();
+  ++sequence;
+}
+
+void DynamicsMeter::snapshot(DynamicsLevels &levels) const {
+  uint32_t seq;
+
+  // retry until no update() ran while we were copying
+  do {
+    seq = sequence;
+    __sync_synchronize();
+    levels = published;
+    __sync_synchronize();
+  } while ((seq & 1) || seq != sequence);
+}
@@ -0,0 +1,80 @@
+#ifndef _DYNAMICS_METER_H
+#define _DYNAMICS_METER_H
+
+#include <Arduino.h>
+#include <AudioStream.h>
+
+#include "FastMath.h"
+#include "FixedPoint.h"
+
+/*
+   Levels of the last block a dynamics effect processed, per channel. Levels are linear on the float scale
+   (1.0 is int16 full scale), gains are the gain reduction alone as a linear factor, without makeup or mix.
+*/
+struct DynamicsLevels {
+  uint32_t blocks;    // blocks recorded since the effect started
+  float peakIn[NUM_CHANNELS], rmsIn[NUM_CHANNELS];
+  float peakOut[NUM_CHANNELS], rmsOut[NUM_CHANNELS];
+  float minGain[NUM_CHANNELS];     // the deepest gain reduction in the block
+  float meanGain[NUM_CHANNELS];
+};
+
+/*
+   Level and gain reduction meter for a dynamics effect's update().
+
+   update() measures each channel's input, output and gain block into a staging copy as it goes, then
+   record() publishes the finished block. The audio interrupt is the only writer; readers take a copy
+   through a sequence counter and retry if a record() landed in the middle, the same as EffectProfiler, so
+   neither side ever waits on the other. Meant to be polled at display rate, a reader sees the newest block.
+*/
+class DynamicsMeter {
+  public:
+    // audio side, a block of channel c before and after processing
+    void measureInput(int c, const float *in) {
+      measure(in, staged.peakIn[c], staged.rmsIn[c]);
+    }
+    void measureOutput(int c, const float *out) {
+      measure(out, staged.peakOut[c], staged.rmsOut[c]);
+    }
+#if FIXED_POINT_DSP
+    void measureInput(int c, const int16_t *in) {
+      measure(in, staged.peakIn[c], staged.rmsIn[c]);
+    }
+    void measureOutput(int c, const int16_t *out) {
+      measure(out, staged.peakOut[c], staged.rmsOut[c]);
+    }
+#endif
+
+    // audio side, the linear gain reduction applied to each sample of channel c
+    void measureGain(int c, const float *gain);
+    // audio side, a gain ramped linearly across the block
+    void measureGain(int c, float from, float to) {
+      staged.minGain[c] = min(from, to);
+      staged.meanGain[c] = 0.5f * (from + to);
+    }
+
+    // audio side, publish the block measured since the last record()
+    void record(void);
+
+    // safe to call from loop() while audio is running
+    void snapshot(DynamicsLevels &levels) const;
+
+    // gain or level to dB, -120 dB for silence
+    static float toDb(float linear) {
+      return linear > 1e-6f ? LOG_TO_DB * fastLog(linear) : -120.0f;
+    }
+
+  private:
+    static void measure(const float *x, float &peak, float &rms);
+#if FIXED_POINT_DSP
+    static void measure(const int16_t *x, float &peak, float &rms);
+#endif
+
+    DynamicsLevels staged = {};
+
+    volatile uint32_t sequence = 0;
+    volatile uint32_t blocks = 0;
+    DynamicsLevels published = {};
+};
+
+#endif /* _DYNAMICS_METER_H */
@@ -0,0 +1,93 @@
+#include "EffectProfiler.h"
+
+#if !defined(ARM_DWT_CYCCNT)
+#include <chrono>
+#endif
+
+#if defined(ARM_DWT_CYCCNT)
+
+EffectProfiler::EffectProfiler() {
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+}
+
+uint32_t EffectProfiler::ticksPerSecond(void) {
+  // F_CPU_ACTUAL follows the Teensy 4 clock scaling, the Teensy 3.x core only has F_CPU
+#if defined(__IMXRT1062__)
+  return F_CPU_ACTUAL;
+#else
+  return F_CPU;
+#endif
+}
+
+#else
+
+EffectProfiler::EffectProfiler() {
+}
+
+// no cycle counter, fall back to a monotonic nanosecond clock
+uint32_t EffectProfiler::readTicks(void) {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t EffectProfiler::ticksPerSecond(void) {
+  return 1000000000;
+}
+
+#endif
+
+float EffectProfiler::ticksToMicros(uint32_t ticks) {
+  return ticks * (1000000.0f / ticksPerSecond());
+}
+
+float EffectProfiler::ticksToPercent(uint32_t ticks) {
+  return ticks * (100.0f * AUDIO_SAMPLE_RATE_EXACT / AUDIO_BLOCK_SAMPLES) / ticksPerSecond();
+}
+
+static int compareTicks(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t*)a;
+  uint32_t y = *(const uint32_t*)b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+void EffectProfiler::snapshot(EffectProfile &profile) const {
+  uint32_t copy[PROFILER_HISTORY];
+  uint32_t seq, count, maxEver;
+
+  // retry until no update() ran while we were copying
+  do {
+    seq = sequence;
+    __sync_synchronize();
+    count = blocks;
+    maxEver = maxTicksEver;
+    for (int i = 0; i < PROFILER_HISTORY; ++i) copy[i] = history[i];
+    __sync_synchronize();
+  } while ((seq & 1) || seq != sequence);
+
+  uint32_t window = min(count, (uint32_t)PROFILER_HISTORY);
+
+  profile.blocks = count;
+  profile.window = window;
+  profile.maxTicksEver = maxEver;
+
+  if (window == 0) {
+    profile.minTicks = profile.meanTicks = profile.p99Ticks = profile.maxTicks = 0;
+    return;
+  }
+
+  qsort(copy, window, sizeof(uint32_t), compareTicks);
+
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < window; ++i) sum += copy[i];
+
+  profile.minTicks = copy[0];
+  profile.meanTicks = (uint32_t)(sum / window);
+  profile.p99Ticks = copy[(window * 99) / 100];
+  profile.maxTicks = copy[window - 1];
+}
+
+void EffectProfiler::reset(void) {
+  // stop() clears the statistics, it stays the only writer of sequence
+  resetRequested = true;
+}
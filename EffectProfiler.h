@@ -0,0 +1,81 @@
+#ifndef _EFFECT_PROFILER_H
+#define _EFFECT_PROFILER_H
+
+#include <Arduino.h>
+#include <AudioStream.h>
+
+// number of most recent blocks kept for the statistics, must be a power of two
+#define PROFILER_HISTORY 256
+
+/*
+   Per-block timing of an effect's update().
+
+   Uses the DWT cycle counter when the core exposes one and a steady clock (nanoseconds) otherwise,
+   see ticksPerSecond(). The Teensy 3.x core doesn't start the cycle counter, the constructor does.
+   The audio interrupt is the only writer, reset() only asks it to clear at its next block. Readers take
+   a copy through a sequence counter and retry if an update() landed in the middle, so interrupts never
+   have to be disabled.
+*/
+
+struct EffectProfile {
+  uint32_t blocks;    // blocks recorded since the last reset
+  uint32_t window;    // how many of those the statistics below cover
+  uint32_t minTicks;
+  uint32_t meanTicks;
+  uint32_t p99Ticks;
+  uint32_t maxTicks;
+  uint32_t maxTicksEver;
+};
+
+class EffectProfiler {
+  public:
+    EffectProfiler();
+
+    inline uint32_t start(void) {
+      return readTicks();
+    }
+
+    inline void stop(uint32_t startTicks) {
+      uint32_t ticks = readTicks() - startTicks;
+
+      ++sequence;
+      __sync_synchronize();
+      if (resetRequested) {
+        blocks = 0;
+        maxTicksEver = 0;
+        resetRequested = false;
+      }
+      history[blocks & (PROFILER_HISTORY - 1)] = ticks;
+      ++blocks;
+      if (ticks > maxTicksEver) maxTicksEver = ticks;
+      __sync_synchronize();
+      ++sequence;
+    }
+
+    // safe to call from loop() while audio is running. reset() takes effect with the next block, until then
+    // snapshot() still returns the old statistics.
+    void snapshot(EffectProfile &profile) const;
+    void reset(void);
+
+    static uint32_t ticksPerSecond(void);
+    static float ticksToMicros(uint32_t ticks);
+    // share of one audio block period, the same scale as AudioStream::processorUsage()
+    static float ticksToPercent(uint32_t ticks);
+
+  private:
+    static uint32_t readTicks(void);
+
+    volatile uint32_t sequence = 0;
+    volatile uint32_t blocks = 0;
+    volatile uint32_t maxTicksEver = 0;
+    volatile bool resetRequested = false;
+    volatile uint32_t history[PROFILER_HISTORY];
+};
+
+#if defined(ARM_DWT_CYCCNT)
+inline uint32_t EffectProfiler::readTicks(void) {
+  return ARM_DWT_CYCCNT;
+}
+#endif
+
+#endif /* _EFFECT_PROFILER_H */
@@ -0,0 +1,90 @@
+#include "EnvelopeFollower.h"
+
+void EnvelopeFollower::process(const float *key, float *out, EnvelopeMode mode) {
+  // copy from class state
+  float coef = this->coef;
+  float state = this->state;
+
+  if (mode == EnvelopePeak) {
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      float level = fastAbs(key[i]);
+      state = level > state ? level : level + coef * (state - level);
+      out[i] = state;
+    }
+  } else {
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      float square = key[i] * key[i];
+      state = square + coef * (state - square);
+      out[i] = state;
+    }
+  }
+
+  // copy back to class state, it decays into the denormal range on a silent channel, flush it
+  this->state = fastAbs(state) < C_DENORM ? 0 : state;
+
+  finish(out, mode);
+}
+
+#if FIXED_POINT_DSP
+/**
+   Squares, and magnitudes for EnvelopePeak, in FIXED_SQUARE_BITS, the pole in Q31. Both stay between 0
+   and full scale, so the difference in the one pole can't overflow. The state goes back to float at the
+   end of the block so the float path can pick up from it.
+*/
+void EnvelopeFollower::processFixed(const int16_t *key, float *out, EnvelopeMode mode) {
+  // copy from class state
+  int32_t coef = fixedCoef;
+  int32_t state = floatToFixed(this->state, FIXED_SQUARE_BITS);
+
+  if (mode == EnvelopePeak) {
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      int32_t level = abs(key[i]) << (FIXED_SQUARE_BITS - 15);
+      state = level > state ? level : level + multiplyFixed(coef, state - level, FIXED_Q31_BITS);
+      out[i] = fixedToFloat(state, FIXED_SQUARE_BITS);
+    }
+  } else {
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      int32_t square = key[i] * key[i];
+      state = square + multiplyFixed(coef, state - square, FIXED_Q31_BITS);
+      out[i] = fixedToFloat(state, FIXED_SQUARE_BITS);
+    }
+  }
+
+  // copy back to class state
+  this->state = fixedToFloat(state, FIXED_SQUARE_BITS);
+
+  finish(out, mode);
+}
+#endif
+
+// the block functions over the finished levels
+void EnvelopeFollower::finish(float *out, EnvelopeMode mode) {
+  if (mode == EnvelopeRms) {
+    fastSqrtBlock<FastMathFast>(out, out);
+  } else if (mode == EnvelopeLogRms) {
+    fastLogBlock(out, out);
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) out[i] *= 0.5f;
+  }
+}
+
+void EnvelopeFollower::linkKeys(const float **key, float *linked) {
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+    float level = fastAbs(key[0][i]);
+    for (int c = 1; c < NUM_CHANNELS; ++c) level = max(level, fastAbs(key[c][i]));
+    linked[i] = level;
+  }
+  key[0] = linked;
+}
+
+#if FIXED_POINT_DSP
+void EnvelopeFollower::linkKeys(const int16_t **key, int16_t *linked) {
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+    int16_t spl = key[0][i];
+    for (int c = 1; c < NUM_CHANNELS; ++c) {
+      if (abs(key[c][i]) > abs(spl)) spl = key[c][i];
+    }
+    linked[i] = spl;
+  }
+  key[0] = linked;
+}
+#endif
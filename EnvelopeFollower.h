@@ -0,0 +1,75 @@
+#ifndef _ENVELOPE_FOLLOWER_H
+#define _ENVELOPE_FOLLOWER_H
+
+#include <Arduino.h>
+
+#include "FastMath.h"
+#include "FixedPoint.h"
+
+/*
+   EnvelopePeak is |x| with an instant attack and a one pole release. EnvelopeRms is the square root of a
+   one pole average of x^2. EnvelopeLogRms is the natural log of the RMS level, taken as half the log of
+   the mean square so there is no square root at all.
+*/
+enum EnvelopeMode {
+  EnvelopePeak, EnvelopeRms, EnvelopeLogRms
+};
+
+/*
+   Level detector for the compressors, one channel, a block at a time.
+
+   The one pole is the only recursive part and runs first over the whole block, a multiply-add per
+   sample. The square root or log then runs over the finished block with the FastMath block functions,
+   which vectorize, instead of once per sample inside the gain computer's loop.
+
+   The coefficient is the pole, exp(-1 / (time * sampleRate)) from designTimeCoef(). 0 follows the input
+   sample by sample, which is how a key that is already a level, like a lookahead peak, is passed through.
+*/
+class EnvelopeFollower {
+  public:
+    void setCoef(float coef) {
+      this->coef = coef;
+#if FIXED_POINT_DSP
+      fixedCoef = floatToFixed(coef, FIXED_Q31_BITS);
+#endif
+    }
+
+    void reset(void) {
+      state = 0;
+    }
+
+    // true once the level has decayed all the way to 0
+    bool isSettled(void) const {
+      return state == 0;
+    }
+
+    // level of AUDIO_BLOCK_SAMPLES of key into out
+    void process(const float *key, float *out, EnvelopeMode mode);
+
+#if FIXED_POINT_DSP
+    // same for int16 keys, the recursion in fixed point, the level out as float on the float scale
+    void processFixed(const int16_t *key, float *out, EnvelopeMode mode);
+#endif
+
+    /*
+       For a linked detector, replace key[0] with the loudest of all NUM_CHANNELS keys, sample by sample.
+       The float version keeps the largest magnitude. The int16 one keeps the sample with the largest
+       magnitude as it is, the magnitude of -32768 doesn't fit, the followers don't mind the sign.
+    */
+    static void linkKeys(const float **key, float *linked);
+#if FIXED_POINT_DSP
+    static void linkKeys(const int16_t **key, int16_t *linked);
+#endif
+
+  private:
+    // mean square, or the peak level in EnvelopePeak
+    float state = 0;
+    float coef = 0;
+#if FIXED_POINT_DSP
+    int32_t fixedCoef = 0;
+#endif
+
+    void finish(float *out, EnvelopeMode mode);
+};
+
+#endif /* _ENVELOPE_FOLLOWER_H */
@@ -1,6 +1,10 @@
 #include <Arduino.h>
 #include "FastMath.h"
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 /////////////////////////////
 // Tanh implementation
 /////////////////////////////
@@ -11,51 +15,80 @@
    - adds odd interval harmonics
    - maybe just up a big of accuracy from here: https://www.wolframalpha.com/input?i=x%2F%281%2Bx%5E2%2F%283%2Bx%5E2%2F%285%2Bx%5E2%2F7%29%29%29+
 */
-float fastTanh(float x) {
+template <FastMathAccuracy ACCURACY>
+static inline float _fastTanh(float x) {
   float x2 = x * x;
+  float a, b;
 
-#ifdef _HIGHER_ACCURACY
-  float a = (((x2 + 378) * x2 + 17325) * x2 + 135135) * x;
-  float b = ((28 * x2 + 3150) * x2 + 62370) * x2 + 135135;
-#else
-  // super fast version, only really usable between +-2.5 input
-  //  float a = x * (x2 + 15);
-  //  float b = 6 * x2 + 15;
-
-  // medium acccuracy version, usable over a much wider range
-  float a = 5 * x * (2 * x2 + 21);
-  float b = x2 * (x2 + 45) + 105;
-#endif
+  switch (ACCURACY) {
+    case FastMathFast:
+      // super fast version, only really usable between +-2.5 input
+      a = x * (x2 + 15);
+      b = 6 * x2 + 15;
+      break;
+    case FastMathMedium:
+      // medium acccuracy version, usable over a much wider range
+      a = 5 * x * (2 * x2 + 21);
+      b = x2 * (x2 + 45) + 105;
+      break;
+    default:
+      a = (((x2 + 378) * x2 + 17325) * x2 + 135135) * x;
+      b = ((28 * x2 + 3150) * x2 + 62370) * x2 + 135135;
+      break;
+  }
 
   return a / b;
 }
 
+template <FastMathAccuracy ACCURACY>
+float fastTanh(float x) {
+  return _fastTanh<ACCURACY>(x);
+}
+
+float fastTanh(float x) {
+  return _fastTanh<FAST_TANH_ACCURACY>(x);
+}
+
 /////////////////////////////
 // Sqrt implementation
 /////////////////////////////
 /**
    https://en.wikipedia.org/wiki/Methods_of_computing_square_roots#Approximations_that_depend_on_the_floating_point_representation
 
-   Fastest so far and averages about 2% error without iteration.
+   Fastest so far and averages about 2% error without iteration. Each Newton step after that squares the
+   error, for up to triple the CPU cycles.
 */
-float fastSqrt(const float x) {
+template <FastMathAccuracy ACCURACY>
+static inline float _fastSqrt(const float x) {
   uint32_t i = *(uint32_t*)&x;
+  // all ones for positive normal x. Zero, denormals and negatives come out of the bit hack near 8e-20,
+  // and squaring that makes a denormal, slow without flush to zero, so they are masked to 0 instead.
+  // Bit masks rather than selects, gcc won't vectorize the block loop with those.
+  uint32_t normal = (uint32_t) -(int32_t) ((int32_t) i >= 0x00800000);
   i -= 1 << 23; /* Subtract 2^m. */
   i >>= 1;    /* Divide by 2. */
   i += 1 << 29; /* Add ((b + 1) / 2) * 2^m. */
-#ifdef _USE_LITTLE_ENDIAN
-  i &= 0xFFFFFF7F; /* ensure that sign bit is not set */
-#else
   i &= 0x7FFFFFFF; /* ensure that sign bit is not set */
-#endif
-  float f = *(float*)&i;
 
-  // this will improve accuracy but up to triple CPU cycles
-#ifdef _HIGHER_ACCURACY
-  f =  (f * f + x) / (2.0f * f);
-#endif
+  if (ACCURACY != FastMathFast) {
+    i = (i & normal) | (0x3F800000 & ~normal); // 1.0 for the masked ones
+    float f = *(float*)&i;
+    f =  (f * f + x) / (2.0f * f);
+    if (ACCURACY == FastMathPrecise) f = (f * f + x) / (2.0f * f);
+    i = *(uint32_t*)&f;
+  }
+
+  i &= normal & 0x7FFFFFFF;
+  return *(float*)&i;   /* Interpret again as float */
+}
+
+template <FastMathAccuracy ACCURACY>
+float fastSqrt(const float x) {
+  return _fastSqrt<ACCURACY>(x);
+}
 
-  return fastAbs(f);   /* Interpret again as float */
+float fastSqrt(const float x) {
+  return _fastSqrt<FAST_SQRT_ACCURACY>(x);
 }
 
 /////////////////////////////
@@ -64,24 +97,29 @@ float fastSqrt(const float x) {
 /**
    https://stackoverflow.com/questions/12227126/division-as-multiply-and-lut-fast-float-division-reciprocal
 */
-float fastRecip(const float f) {
+template <FastMathAccuracy ACCURACY>
+static inline float _fastRecip(const float f) {
   // get a good estimate via bit twiddling
   uint32_t x = *(uint32_t*)&f;
-#ifdef _USE_LITTLE_ENDIAN
-  x = 0xC211FE7E - x;
-#else
   x = 0x7EF311C2 - x;
-#endif
   float inv = *(float*)&x;
 
-  // newton-raphson iteration for accuracy
-#ifdef _HIGHER_ACCURACY
-  inv *=  2 - inv * f;
-#endif
+  // newton-raphson iterations for accuracy, each squares the error
+  if (ACCURACY != FastMathFast) inv *=  2 - inv * f;
+  if (ACCURACY == FastMathPrecise) inv *=  2 - inv * f;
 
   return inv;
 }
 
+template <FastMathAccuracy ACCURACY>
+float fastRecip(const float f) {
+  return _fastRecip<ACCURACY>(f);
+}
+
+float fastRecip(const float f) {
+  return _fastRecip<FAST_RECIP_ACCURACY>(f);
+}
+
 /////////////////////////////
 // Sine implementation
 /////////////////////////////
@@ -92,15 +130,18 @@ float fastRecip(const float f) {
    possible extra adds to constrain input value
 
 */
-float fastSin(float x) {
-
+static inline float _fastSinWrap(float x) {
   // constrain input value
-  while (x < 0) x += TWO_PI;
-  while (x > TWO_PI) x -= TWO_PI;
+  while (x < 0) x += (float) TWO_PI;
+  while (x > (float) TWO_PI) x -= (float) TWO_PI;
+  return x;
+}
 
+// x must already be in 0 to TWO_PI
+static inline float _fastSinWrapped(float x) {
   boolean neg = false;
-  if (x > PI) {
-    x -= PI;
+  if (x > (float) PI) {
+    x -= (float) PI;
     neg = true;
   }
 
@@ -119,36 +160,28 @@ float fastSin(float x) {
   return neg ? -value : value;
 }
 
+float fastSin(float x) {
+  return _fastSinWrapped(_fastSinWrap(x));
+}
+
 //////////////////////////////////
 // Float hacks implementations
 //////////////////////////////////
 float fastAbs(float f) {
   uint32_t i = *(uint32_t*)&f;
   // unset sign bit
-#ifdef _USE_LITTLE_ENDIAN
   i &= 0x7FFFFFFF;
-#else
-  i &= 0xFFFFFF7F;
-#endif
   return *(float*)&i;
 }
 
 bool fastNonZero(const float x) {
   uint32_t i = *(uint32_t*)&x;
-#ifdef _USE_LITTLE_ENDIAN
-  return (i & 0xFFFFFF7F) != 0;
-#else
   return (i & 0x7FFFFFFF) != 0;
-#endif
 }
 
 bool fastIsNegative(const float x) {
   uint32_t i = *(uint32_t*)&x;
-#ifdef _USE_LITTLE_ENDIAN
-  return (i & 0x00000080) != 0;
-#else
   return (i & 0x80000000) != 0;
-#endif
 }
 
 /////////////////////////////
@@ -194,36 +227,40 @@ float _fastPow(const float a, const float b) {
 /**
    Borrowed from https://stackoverflow.com/questions/10552280/fast-exp-calculation-possible-to-improve-accuracy-without-losing-too-much-perfo
 */
-float fastExp(const float x) {
+static inline float _fastExp(const float x) {
   /* exp(x) = 2^i * 2^f; i = floor (log2(e) * x), 0 <= f <= 1 */
-  float t = x * 1.442695041f;
-  float fi = (float) ((int) t);
-  float f = t - fi;
-  int i = (int) fi;
+  float t = x * LOG2_E;
+  // floor, not truncation, so f stays in [0, 1) for negative x as well
+  int i = (int) t;
+  i -= (float) i > t;
+  float f = t - (float) i;
   float cvtF = (0.3371894346f * f + 0.657636276f) * f + 1.00172476f; /* compute 2^f */
+  // keep 2^i a normal float, beyond that the exponent add below would wrap into the sign bit.
+  // Clamped as an int so the block loop still vectorizes.
+  i = i < -125 ? -125 : (i > 127 ? 127 : i);
   uint32_t cvtI = *(uint32_t*)&cvtF;
-  cvtI += (i << 23);                                          /* scale by 2^i */
+  cvtI += (uint32_t) i << 23;                                 /* scale by 2^i */
   return *(float*)&cvtI;
 }
 
+float fastExp(const float x) {
+  return _fastExp(x);
+}
+
 /////////////////////////////
 // Natural log implementation
 /////////////////////////////
 /**
    Borrowed from https://stackoverflow.com/questions/39821367/very-fast-approximate-logarithm-natural-log-function-in-c
 */
-float fastLog(const float a) {
+static inline float _fastLog(const float a) {
   float m, r, s, t, i, f;
   uint32_t aI = *(uint32_t*)&a;
 
-#ifdef _USE_LITTLE_ENDIAN
-  uint32_t e = (aI - 0xabaa3a3f) & 0x000080ff;
-#else
   uint32_t e = (aI - 0x3f2aaaab) & 0xff800000;
-#endif
   uint32_t aIMinusE = (aI - e);
   m = *(float*)&aIMinusE;
-  i = (float) e * 1.19209290e-7f; // 0x1.0p-23
+  i = (float)(int32_t) e * 1.19209290e-7f; // 0x1.0p-23, the exponent is negative below 2/3
   /* m in [2/3, 4/3] */
   f = m - 1.0f;
   s = f * f;
@@ -232,6 +269,143 @@ float fastLog(const float a) {
   t = 0.331826031f * f - 0.498910338f; // 0x1.53ca34p-2, -0x1.fee25ap-2
   r = r * s + t;
   r = r * s + f;
-  r = i * 0.693147182f + r; // 0x1.62e430p-1 // log(2)
+  r = i * LN_2 + r;
   return r;
 }
+
+float fastLog(const float a) {
+  return _fastLog(a);
+}
+
+/**
+   The precise tier takes ln(m) as 2 atanh((m - 1) / (m + 1)) instead, |z| <= 1/5 over [2/3, 4/3] so the
+   series is done to float precision by z^9, for one division more. The fast and medium tiers are the
+   polynomial above.
+*/
+template <FastMathAccuracy ACCURACY>
+float fastLog(const float a) {
+  if (ACCURACY != FastMathPrecise) return _fastLog(a);
+
+  uint32_t aI = *(uint32_t*)&a;
+  uint32_t e = (aI - 0x3f2aaaab) & 0xff800000;
+  uint32_t aIMinusE = (aI - e);
+  float m = *(float*)&aIMinusE;
+  float i = (float)(int32_t) e * 1.19209290e-7f;
+  float z = (m - 1.0f) / (m + 1.0f);
+  float z2 = z * z;
+  float r = 2 * z * (1 + z2 * (1 / 3.0f + z2 * (1 / 5.0f + z2 * (1 / 7.0f + z2 * (1 / 9.0f)))));
+  return i * LN_2 + r;
+}
+
+/////////////////////////////
+// Atan implementation
+/////////////////////////////
+/**
+   Abramowitz and Stegun 4.4.49, a polynomial in x^2 good to 2e-8 over [0, 1], folded out from there with
+   atan(x) = pi / 2 - atan(1 / x).
+*/
+static inline float _fastAtan(const float x) {
+  float a = fabsf(x);
+  bool outside = a > 1;
+  float t = outside ? 1 / a : a;
+  float t2 = t * t;
+  float r = t * (1 + t2 * (-0.3333314528f + t2 * (0.1999355085f + t2 * (-0.1420889944f + t2 * (0.1065626393f
+            + t2 * (-0.0752896400f + t2 * (0.0429096138f + t2 * (-0.0161657367f + t2 * 0.0028662257f))))))));
+  if (outside) r = 1.57079633f - r;
+  return x < 0 ? -r : r;
+}
+
+float fastAtan(const float x) {
+  return _fastAtan(x);
+}
+
+/////////////////////////////
+// Block implementations
+/////////////////////////////
+/**
+   Process AUDIO_BLOCK_SAMPLES values per call using the same inline kernels as the scalar versions,
+   so results are identical bit for bit. Saves the call per sample and lets the compiler pipeline
+   (or vectorize, where the target has float SIMD) the fixed length loops.
+   in and out may be the same array, but must not otherwise overlap.
+*/
+template <FastMathAccuracy ACCURACY>
+void fastTanhBlock(const float *in, float *out) {
+#pragma GCC ivdep
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) out[i] = _fastTanh<ACCURACY>(in[i]);
+}
+
+void fastTanhBlock(const float *in, float *out) {
+  fastTanhBlock<FAST_TANH_ACCURACY>(in, out);
+}
+
+template <FastMathAccuracy ACCURACY>
+void fastSqrtBlock(const float *in, float *out) {
+#pragma GCC ivdep
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) out[i] = _fastSqrt<ACCURACY>(in[i]);
+}
+
+void fastSqrtBlock(const float *in, float *out) {
+  fastSqrtBlock<FAST_SQRT_ACCURACY>(in, out);
+}
+
+template <FastMathAccuracy ACCURACY>
+void fastRecipBlock(const float *in, float *out) {
+#pragma GCC ivdep
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) out[i] = _fastRecip<ACCURACY>(in[i]);
+}
+
+void fastRecipBlock(const float *in, float *out) {
+  fastRecipBlock<FAST_RECIP_ACCURACY>(in, out);
+}
+
+void fastSinBlock(const float *in, float *out) {
+  // range reduction loops can't be vectorized, but they hardly ever run, so do them in a first pass
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) out[i] = _fastSinWrap(in[i]);
+#pragma GCC ivdep
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) out[i] = _fastSinWrapped(out[i]);
+}
+
+void fastExpBlock(const float *in, float *out) {
+#pragma GCC ivdep
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) out[i] = _fastExp(in[i]);
+}
+
+void fastLogBlock(const float *in, float *out) {
+#pragma GCC ivdep
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) out[i] = _fastLog(in[i]);
+}
+
+/////////////////////////////
+// Accuracy tiers
+/////////////////////////////
+#define FAST_MATH_INSTANTIATE(ACCURACY) \
+  template float fastTanh<ACCURACY>(float x); \
+  template float fastSqrt<ACCURACY>(const float x); \
+  template float fastRecip<ACCURACY>(const float f); \
+  template float fastLog<ACCURACY>(const float a); \
+  template void fastTanhBlock<ACCURACY>(const float *in, float *out); \
+  template void fastSqrtBlock<ACCURACY>(const float *in, float *out); \
+  template void fastRecipBlock<ACCURACY>(const float *in, float *out);
+
+FAST_MATH_INSTANTIATE(FastMathFast)
+FAST_MATH_INSTANTIATE(FastMathMedium)
+FAST_MATH_INSTANTIATE(FastMathPrecise)
+
+//////////////////////////////////
+// Denormal handling
+//////////////////////////////////
+#define FPSCR_FZ (1 << 24)
+#define FPU_FPDSCR (*(volatile uint32_t *)0xE000EF3C)
+#define MXCSR_FTZ_DAZ 0x8040
+
+void enableFlushToZero(void) {
+#if defined(__arm__) && defined(__ARM_FP)
+  uint32_t fpscr;
+  asm volatile("vmrs %0, fpscr" : "=r"(fpscr));
+  asm volatile("vmsr fpscr, %0" : : "r"(fpscr | FPSCR_FZ));
+  // exception handlers, update() among them, start from the default FPSCR rather than the thread's one
+  FPU_FPDSCR |= FPSCR_FZ;
+#elif defined(__SSE__)
+  _mm_setcsr(_mm_getcsr() | MXCSR_FTZ_DAZ);
+#endif
+}
@@ -1,18 +1,23 @@
 #ifndef _FAST_MATH_H
 #define _FAST_MATH_H
 
-#define _HIGHER_ACCURACY
-#define _USE_LITTLE_ENDIAN
+// the float bit hacks read a float's bits as a uint32_t of the same byte order, so they need no endian variants
 
+// channels every effect processes, 2 for e.g. a DI + mic rig. Override from the build to change it.
+#ifndef NUM_CHANNELS
 #define NUM_CHANNELS 1
+#endif
 #define AUDIO_BLOCK_SAMPLES 128
-inline
-#define C_DC_ADD  10E-30
-#define C_DENORM 10E-30
-#define C_AMP_DB 8.65617025
-#define LOG_TO_DB  8.6858896380650365530225783783321 // 20 / ln(10)
-#define DB_TO_LOG  0.11512925464970228420089957273422 // ln(10) / 20 
-#define BLOWN_CAP_SCALAR 2.08136898
+// float literals throughout, a double one drags the whole expression into software double precision on
+// the Teensy's single precision FPU
+#define C_DC_ADD  10E-30f
+#define C_DENORM 10E-30f
+#define C_AMP_DB 8.65617025f
+#define LOG_TO_DB  8.68588964f // 20 / ln(10)
+#define DB_TO_LOG  0.115129255f // ln(10) / 20
+#define LOG2_E 1.442695041f
+#define LN_2 0.693147182f // 0x1.62e430p-1
+#define BLOWN_CAP_SCALAR 2.08136898f
 #define FLOAT_TO_INT  32768
 #define INT_TO_FLOAT  1.0f/FLOAT_TO_INT
 #define MIN_FREQ 20
@@ -27,10 +32,47 @@ inline
 #define AA_STEP_7 1.0/7.0
 #define AA_STEP_8 1.0/8.0
 
+/*
+   Accuracy tiers for fastTanh(), fastSqrt() and fastRecip(), picked per call site as a template argument,
+   e.g. fastSqrt<FastMathFast>(x) for a level detector that doesn't need better than a few percent.
+   Max error and host cost (one at a time / per sample in a block), from fastmath_bench:
+
+              fastTanh over +-3           fastSqrt over 0..2          fastRecip over 0.01..2
+   fast       4.8e-2 abs, 1.7 / 0.3ns     6.1e-2 rel, 1.8 / 0.4ns     5.1e-2 rel, 1.8 / 0.1ns
+   medium     5.2e-3 abs, 2.1 / 0.4ns     1.7e-3 rel, 2.6 / 0.6ns     2.6e-3 rel, 2.0 / 0.2ns
+   precise    1.1e-6 abs, 2.4 / 0.6ns     1.6e-6 rel, 3.5 / 0.7ns     6.6e-6 rel, 2.2 / 0.3ns
+
+   Fast tanh climbs past 1 from about 2.3, medium peaks at 0.99 near 3 and falls back towards 0. On the Cortex-M7
+   the division dominates the tanh tiers (14 cycles against 2 to 6 multiply-adds for the polynomials),
+   each Newton step adds a division to fastSqrt and two multiply-adds to fastRecip.
+
+   fastLog() has a precise tier as well, for the antiderivative antialiasing, whose second order divides
+   differences of logs by a small step. The untemplated fastLog() is its fast and medium tier.
+
+   The compressors' detectors and ratio use the fast tiers, the saturation stages and the antiderivative
+   antialiasing the precise ones. fastmath_bench reports each call site over the inputs it sees.
+
+   The untemplated functions use the FAST_*_ACCURACY tier, which can be overridden from the build.
+*/
+enum FastMathAccuracy {
+  FastMathFast, FastMathMedium, FastMathPrecise
+};
+
+#ifndef FAST_TANH_ACCURACY
+#define FAST_TANH_ACCURACY FastMathPrecise
+#endif
+#ifndef FAST_SQRT_ACCURACY
+#define FAST_SQRT_ACCURACY FastMathMedium
+#endif
+#ifndef FAST_RECIP_ACCURACY
+#define FAST_RECIP_ACCURACY FastMathMedium
+#endif
+
 float addEvenOrderHarmonics(float x);
 float saturation(float y0, float y2, int antiAliasSteps, float drive);
 
 float fastAbs(float f);
+float fastAtan(const float x);
 float fastExp(const float x);
 bool fastIsNegative(const float x);
 float fastLog(const float a);
@@ -41,6 +83,26 @@ float fastSin(float x);
 float fastSqrt(const float x);
 float fastTanh(float x);
 
+// denormals read and written as zero from here on, also inside the audio interrupt where the platform allows it
+void enableFlushToZero(void);
+
+template <FastMathAccuracy ACCURACY> float fastRecip(const float f);
+template <FastMathAccuracy ACCURACY> float fastSqrt(const float x);
+template <FastMathAccuracy ACCURACY> float fastTanh(float x);
+template <FastMathAccuracy ACCURACY> float fastLog(const float a);
+
+// block versions, AUDIO_BLOCK_SAMPLES values in and out, same results as the scalar versions
+void fastExpBlock(const float *in, float *out);
+void fastLogBlock(const float *in, float *out);
+void fastRecipBlock(const float *in, float *out);
+void fastSinBlock(const float *in, float *out);
+void fastSqrtBlock(const float *in, float *out);
+void fastTanhBlock(const float *in, float *out);
+
+template <FastMathAccuracy ACCURACY> void fastRecipBlock(const float *in, float *out);
+template <FastMathAccuracy ACCURACY> void fastSqrtBlock(const float *in, float *out);
+template <FastMathAccuracy ACCURACY> void fastTanhBlock(const float *in, float *out);
+
 // implementation methods not intended for general use
 float _fastPow(const float a, const float b);
 float _floatToIntPower(float base, int power);
@@ -0,0 +1,11 @@
+#include "FastMathTables.h"
+
+#define FAST_MATH_TABLE_DEFINE(BITS) \
+  template <> constexpr Exp2Table<BITS> FastMathTable<BITS>::EXP2 PROGMEM = Exp2Table<BITS>(); \
+  template <> constexpr Log2Table<BITS> FastMathTable<BITS>::LOG2 PROGMEM = Log2Table<BITS>(); \
+  template <> constexpr SineQuadrantTable<BITS> FastMathTable<BITS>::SINE PROGMEM = SineQuadrantTable<BITS>();
+
+FAST_MATH_TABLE_DEFINE(6)
+FAST_MATH_TABLE_DEFINE(8)
+FAST_MATH_TABLE_DEFINE(10)
+FAST_MATH_TABLE_DEFINE(12)
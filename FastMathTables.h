@@ -0,0 +1,220 @@
+#ifndef _FAST_MATH_TABLES_H
+#define _FAST_MATH_TABLES_H
+
+#include <Arduino.h>
+
+#include "FastMath.h"
+
+// entries per table as a power of two, the default for the FastMathTable<> variants
+#ifndef FAST_MATH_TABLE_BITS
+#define FAST_MATH_TABLE_BITS 8
+#endif
+
+// Teensyduino defines it, elsewhere const data stays wherever the compiler puts it
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+/*
+   Lookup table versions of fastExp(), fastLog() and fastSin().
+
+   The tables are built by the compiler. The generators below are constexpr series in double and the
+   constructors fill the arrays in constant expressions, so the tables land in flash (PROGMEM, the Teensy 4
+   would copy plain const data to RAM) as ordinary data with no startup code and nothing to forget to call.
+   The sizes FastMathTables.cpp defines are 6, 8, 10 and 12 bits. The linker drops the ones nobody reads.
+
+   Every lookup interpolates linearly between neighbouring entries. With the default 256 entries the
+   error is under 1.5e-6 relative for exp, 2.2e-6 absolute for log and 5e-6 absolute for sin, against
+   1.7e-3, 1.5e-5 and 3.9e-3 for the formulas. Whether that is faster depends on the target's memory: on the
+   Teensy 4 flash reads go through the cache, on the host the formulas vectorize.
+
+   The variant is picked with a template parameter, so a call site says what it wants and the default
+   formulas stay untouched:
+      fastExp<FastMathTable<> >(x)     table with FAST_MATH_TABLE_BITS bits
+      fastLog<FastMathTable<10> >(x)   1024 entries
+      fastSin<FastMathFormula>(x)      same as fastSin(x)
+*/
+
+// implementation methods not intended for general use, double precision series for the table generators
+
+// e^x for |x| <= 1
+constexpr double _constExp(double x) {
+  double sum = 1, term = 1;
+  for (int k = 1; k < 24; ++k) {
+    term *= x / k;
+    sum += term;
+  }
+  return sum;
+}
+
+// ln(x) for x in [1, 2], as 2 atanh((x - 1) / (x + 1)) with the argument at most 1/3
+constexpr double _constLog(double x) {
+  double z = (x - 1) / (x + 1);
+  double z2 = z * z;
+  double sum = 0, power = z;
+  for (int k = 0; k < 32; ++k) {
+    sum += power / (2 * k + 1);
+    power *= z2;
+  }
+  return 2 * sum;
+}
+
+// sin(x) for x in [0, pi / 2] and a little past
+constexpr double _constSin(double x) {
+  double sum = 0, term = x;
+  for (int k = 1; k < 24; k += 2) {
+    sum += term;
+    term *= -x * x / ((k + 1) * (k + 2));
+  }
+  return sum;
+}
+
+/*
+   2^(i / SIZE) over one octave, 2^f for the fractional part of the exponent.
+*/
+template <int BITS>
+struct Exp2Table {
+  static const int SIZE = 1 << BITS;
+  float values[SIZE + 1];
+
+  constexpr Exp2Table() : values() {
+    for (int i = 0; i <= SIZE; ++i) values[i] = (float) _constExp(i * 0.69314718055994530942 / SIZE);
+  }
+};
+
+/*
+   log2(1 + i / SIZE), indexed by the top BITS bits of the float mantissa.
+*/
+template <int BITS>
+struct Log2Table {
+  static const int SIZE = 1 << BITS;
+  float values[SIZE + 1];
+
+  constexpr Log2Table() : values() {
+    for (int i = 0; i <= SIZE; ++i) values[i] = (float) (_constLog(1 + (double) i / SIZE) * 1.4426950408889634074);
+  }
+};
+
+/*
+   sin(i / SIZE * pi / 2), one quadrant, the others are mirrors and negations of it. One entry past pi / 2
+   so the mirrored lookup can interpolate from the very top.
+*/
+template <int BITS>
+struct SineQuadrantTable {
+  static const int SIZE = 1 << BITS;
+  float values[SIZE + 2];
+
+  constexpr SineQuadrantTable() : values() {
+    for (int i = 0; i <= SIZE + 1; ++i) values[i] = (float) _constSin(i * 1.5707963267948966192 / SIZE);
+  }
+};
+
+/*
+   The formulas in FastMath.cpp, to pass where a table variant could go.
+*/
+struct FastMathFormula {
+  static float exp(float x) {
+    return fastExp(x);
+  }
+  static float log(float x) {
+    return fastLog(x);
+  }
+  static float sin(float x) {
+    return fastSin(x);
+  }
+};
+
+/*
+   Table lookups with 2^BITS entries per table. Same input ranges as the formulas: log() wants a positive
+   normal float, exp() clamps 2^i the way fastExp() does.
+*/
+template <int BITS = FAST_MATH_TABLE_BITS>
+struct FastMathTable {
+  static_assert(BITS == 6 || BITS == 8 || BITS == 10 || BITS == 12, "FastMathTable has 6, 8, 10 or 12 bits");
+
+  static const Exp2Table<BITS> EXP2;
+  static const Log2Table<BITS> LOG2;
+  static const SineQuadrantTable<BITS> SINE;
+
+  static float exp(float x) {
+    const int size = 1 << BITS;
+
+    // exp(x) = 2^i * 2^f, i = floor(log2(e) * x), 0 <= f < 1
+    float t = x * LOG2_E;
+    int i = (int) t;
+    i -= (float) i > t;
+    // f * size only moves the exponent, so it stays below size
+    float position = (t - (float) i) * size;
+    int index = (int) position;
+    float fraction = position - (float) index;
+    const float *values = EXP2.values + index;
+    float cvtF = values[0] + fraction * (values[1] - values[0]);
+
+    i = i < -125 ? -125 : (i > 127 ? 127 : i);
+    uint32_t cvtI = *(uint32_t*)&cvtF;
+    cvtI += (uint32_t) i << 23;
+    return *(float*)&cvtI;
+  }
+
+  static float log(float x) {
+    const int shift = 23 - BITS;
+
+    uint32_t i = *(uint32_t*)&x;
+    int e = (int) (i >> 23) - 127;
+    uint32_t mantissa = i & 0x007FFFFF;
+    uint32_t index = mantissa >> shift;
+    float fraction = (float) (mantissa & ((1 << shift) - 1)) * (1.0f / (1 << shift));
+    const float *values = LOG2.values + index;
+    return ((float) e + values[0] + fraction * (values[1] - values[0])) * LN_2;
+  }
+
+  static float sin(float x) {
+    const int size = 1 << BITS;
+
+    // quarter turns, the integer part picks the quadrant
+    float t = x * (float) (2 / PI);
+    int q = (int) t;
+    q -= (float) q > t;
+    float position = (t - (float) q) * size;
+
+    // the falling quadrants read the table backwards from pi / 2
+    position = q & 1 ? size - position : position;
+    int index = (int) position;
+    float fraction = position - (float) index;
+    const float *values = SINE.values + index;
+    float value = values[0] + fraction * (values[1] - values[0]);
+    return q & 2 ? -value : value;
+  }
+};
+
+/*
+   Defined for each size in FastMathTables.cpp. gcc ignores section attributes on implicitly instantiated
+   template members, explicit specializations keep them.
+*/
+#define FAST_MATH_TABLE_DECLARE(BITS) \
+  template <> const Exp2Table<BITS> FastMathTable<BITS>::EXP2; \
+  template <> const Log2Table<BITS> FastMathTable<BITS>::LOG2; \
+  template <> const SineQuadrantTable<BITS> FastMathTable<BITS>::SINE;
+
+FAST_MATH_TABLE_DECLARE(6)
+FAST_MATH_TABLE_DECLARE(8)
+FAST_MATH_TABLE_DECLARE(10)
+FAST_MATH_TABLE_DECLARE(12)
+
+// fastExp<FastMathTable<> >(x) and so on, METHOD is FastMathFormula or a FastMathTable
+template <class METHOD>
+inline float fastExp(float x) {
+  return METHOD::exp(x);
+}
+
+template <class METHOD>
+inline float fastLog(float x) {
+  return METHOD::log(x);
+}
+
+template <class METHOD>
+inline float fastSin(float x) {
+  return METHOD::sin(x);
+}
+
+#endif /* _FAST_MATH_TABLES_H */
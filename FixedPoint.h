@@ -0,0 +1,119 @@
+#ifndef _FIXED_POINT_H
+#define _FIXED_POINT_H
+
+#include <Arduino.h>
+
+#include "FastMath.h"
+
+/*
+   Fixed point processing of int16 blocks, for the parts where float costs more than integer math.
+
+   With FIXED_POINT_DSP set to 1 from the build, effects that have a fixed point path take int16
+   audio_block_t::data as it comes in over an AudioConnection, with no conversion to float and back. Float
+   blocks from an AudioConnectionFloat still run through process() as before.
+
+   Formats, as the number of fraction bits in an int32_t:
+      samples        int16 << FIXED_SAMPLE_SHIFT, 1.0 is 2^27, 24 dB of headroom for EQ boosts
+      coefficients   FIXED_COEF_BITS, 1.0 is 2^28, covers |a1| < 2 and peaking gains to +18 dB
+      gains          FIXED_GAIN_BITS, 1.0 is 2^27, up to +24 dB
+      squares        FIXED_SQUARE_BITS, an int16 sample squared, full scale is 2^30
+      time coefs     Q31, one pole smoothing coefficients are always below 1
+   Products are taken in 64 bits (one SMLAL on the Cortex-M4/M7) and shifted back down.
+*/
+
+#ifndef FIXED_POINT_DSP
+#define FIXED_POINT_DSP 0
+#endif
+
+#define FIXED_SAMPLE_SHIFT 12
+#define FIXED_COEF_BITS 28
+#define FIXED_GAIN_BITS 27
+#define FIXED_SQUARE_BITS 30
+#define FIXED_Q31_BITS 31
+
+// log2(AUDIO_BLOCK_SAMPLES), ramps across a block divide by shifting
+#define FIXED_BLOCK_SHIFT 7
+
+static_assert(AUDIO_BLOCK_SAMPLES == 1 << FIXED_BLOCK_SHIFT, "FIXED_BLOCK_SHIFT must match AUDIO_BLOCK_SAMPLES");
+
+/**
+   x * 2^bits rounded to nearest, saturated to the int32_t range
+*/
+inline int32_t floatToFixed(float x, int bits) {
+  float scaled = x * (float) (1u << bits);
+  // 2^31 is the first float past INT32_MAX
+  if (scaled >= 2147483648.0f) return INT32_MAX;
+  if (scaled <= -2147483648.0f) return INT32_MIN;
+  return (int32_t) (scaled + (scaled < 0 ? -0.5f : 0.5f));
+}
+
+inline float fixedToFloat(int32_t x, int bits) {
+  return (float) x * (1.0f / (float) (1u << bits));
+}
+
+// (a * b) >> bits in 64 bits, floor rounding
+inline int32_t multiplyFixed(int32_t a, int32_t b, int bits) {
+  return (int32_t) (((int64_t) a * b) >> bits);
+}
+
+/**
+   Clamp to int16, the compiler turns this into SSAT on the Cortex-M4/M7
+*/
+inline int16_t saturate16(int32_t x) {
+  return x > 32767 ? 32767 : (x < -32768 ? -32768 : (int16_t) x);
+}
+
+// largest working sample, short of INT32_MAX by the rounding fixedToInt16() adds
+#define FIXED_SAMPLE_MAX (INT32_MAX - (1 << (FIXED_SAMPLE_SHIFT - 1)))
+
+/**
+   A 64 bit result back to a working sample, clamped instead of wrapping around. Stacked boosts can take
+   a filter past the 24 dB of headroom.
+*/
+inline int32_t saturateSample(int64_t x) {
+  return x > FIXED_SAMPLE_MAX ? FIXED_SAMPLE_MAX : (x < -FIXED_SAMPLE_MAX ? -FIXED_SAMPLE_MAX : (int32_t) x);
+}
+
+/**
+   d[i] *= gain[i] * scale + offset over a block. The gain is converted to FIXED_GAIN_BITS only at its control
+   points, the last sample of every 2^rampShift, and ramped linearly towards them in integers from last, the
+   gain the previous block ended on, so a gain computer that ramps linearly between its control points comes
+   out the same. last < 0 starts on the first control point.
+*/
+inline void applyGainFixed(int16_t *d, const float *gain, float scale, float offset, int rampShift,
+                           int32_t &last) {
+  const int32_t half = 1 << (FIXED_GAIN_BITS - 1);
+  const int step = 1 << rampShift;
+
+  int32_t q = last;
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i += step) {
+    int32_t to = floatToFixed(gain[i + step - 1] * scale + offset, FIXED_GAIN_BITS);
+    if (q < 0) q = to;
+    int32_t dq = (to - q) >> rampShift;
+    for (int j = i; j < i + step - 1; ++j) {
+      q += dq;
+      d[j] = saturate16((int32_t) (((int64_t) d[j] * q + half) >> FIXED_GAIN_BITS));
+    }
+    // land on the control point exactly, the shift rounded the steps down
+    q = to;
+    d[i + step - 1] = saturate16((int32_t) (((int64_t) d[i + step - 1] * q + half) >> FIXED_GAIN_BITS));
+  }
+  last = q;
+}
+
+/**
+   int16 block to the working sample format
+*/
+inline void fixedFromInt16(const int16_t *in, int32_t *out) {
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) out[i] = (int32_t) in[i] << FIXED_SAMPLE_SHIFT;
+}
+
+/**
+   Working samples back to int16, rounded and saturated
+*/
+inline void fixedToInt16(const int32_t *in, int16_t *out) {
+  const int32_t half = 1 << (FIXED_SAMPLE_SHIFT - 1);
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) out[i] = saturate16((in[i] + half) >> FIXED_SAMPLE_SHIFT);
+}
+
+#endif /* _FIXED_POINT_H */
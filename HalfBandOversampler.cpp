@@ -0,0 +1,88 @@
+#include "HalfBandOversampler.h"
+
+constexpr float HalfBandCoefficients::STAGE_1[];
+constexpr float HalfBandCoefficients::STAGE_2[];
+constexpr float HalfBandCoefficients::STAGE_3[];
+
+float HalfBandOversampler::bufferA[AUDIO_BLOCK_SAMPLES * OVERSAMPLING_MAX];
+float HalfBandOversampler::bufferB[AUDIO_BLOCK_SAMPLES * OVERSAMPLING_MAX / 2];
+
+void HalfBandOversampler::setFactor(int factor) {
+  this->factor = roundFactor(factor);
+
+  stage1.reset();
+  stage2.reset();
+  stage3.reset();
+}
+
+int HalfBandOversampler::roundFactor(int factor) {
+  int f = 1;
+  while (f * 2 <= factor && f * 2 <= OVERSAMPLING_MAX) f *= 2;
+  return f;
+}
+
+/**
+   Each stage delays by 2K + 1 samples of its own high rate on the way up and again on the way down:
+   19 samples for the first stage, 2.5 for the second and 0.75 for the third.
+*/
+int HalfBandOversampler::latency(int factor) {
+  switch (roundFactor(factor)) {
+    case 2:
+      return 19;
+    case 4:
+      return 21;
+    case 8:
+      return 22;
+    default:
+      return 0;
+  }
+}
+
+/**
+   The stages ping-pong between the two shared buffers so the last one up ends in bufferA, which is big
+   enough for the full rate block, and the way down retraces the same steps.
+*/
+float *HalfBandOversampler::upsample(const float *in) {
+  const int n = AUDIO_BLOCK_SAMPLES;
+
+  switch (factor) {
+    case 2:
+      stage1.upsample(in, bufferA, n);
+      break;
+    case 4:
+      stage1.upsample(in, bufferB, n);
+      stage2.upsample(bufferB, bufferA, 2 * n);
+      break;
+    case 8:
+      stage1.upsample(in, bufferA, n);
+      stage2.upsample(bufferA, bufferB, 2 * n);
+      stage3.upsample(bufferB, bufferA, 4 * n);
+      break;
+    default:
+      memcpy(bufferA, in, n * sizeof(float));
+      break;
+  }
+  return bufferA;
+}
+
+void HalfBandOversampler::downsample(float *out) {
+  const int n = AUDIO_BLOCK_SAMPLES;
+
+  switch (factor) {
+    case 2:
+      stage1.downsample(bufferA, out, n);
+      break;
+    case 4:
+      stage2.downsample(bufferA, bufferB, 2 * n);
+      stage1.downsample(bufferB, out, n);
+      break;
+    case 8:
+      stage3.downsample(bufferA, bufferB, 4 * n);
+      stage2.downsample(bufferB, bufferA, 2 * n);
+      stage1.downsample(bufferA, out, n);
+      break;
+    default:
+      memcpy(out, bufferA, n * sizeof(float));
+      break;
+  }
+}
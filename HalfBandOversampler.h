@@ -0,0 +1,155 @@
+#ifndef _HALF_BAND_OVERSAMPLER_H
+#define _HALF_BAND_OVERSAMPLER_H
+
+#include <Arduino.h>
+#include <AudioStream.h>
+#include <string.h>
+
+#include "FastMath.h"
+
+// highest oversampling factor, 2 to the number of half-band stages
+#define OVERSAMPLING_MAX 8
+
+/*
+   Half-band lowpass designs for the 2x stages, equiripple (Parks-McClellan) with the cutoff at a quarter
+   of the high rate. Every other tap of a half-band filter is zero and the centre tap is 0.5, so only the
+   taps at odd offsets 1, 3, 5... from the centre are stored, one side of the symmetric response.
+
+   The first stage sits at the edge of the audio band and needs the steep one. The later stages only have
+   to keep their images out of what the stages before them pass, so a few taps do.
+
+   They are class members rather than file statics so every translation unit instantiates the stages
+   with the same tables.
+*/
+struct HalfBandCoefficients {
+  // 39 taps, flat to 0.2 of the 2x rate (17.6kHz at 44.1kHz), 69dB down from 0.3
+  static constexpr float STAGE_1[10] = {
+    3.161337846e-01f, -9.972502693e-02f, 5.351152234e-02f, -3.220490401e-02f, 1.978160945e-02f,
+    -1.188262717e-02f, 6.773608404e-03f, -3.549788794e-03f, 1.630702023e-03f, -6.384939155e-04f
+  };
+
+  // 11 taps, flat to 0.1 of the 4x rate, 68dB down from 0.4
+  static constexpr float STAGE_2[3] = {
+    2.985905845e-01f, -5.811350108e-02f, 9.705091935e-03f
+  };
+
+  // 7 taps, flat to 0.05 of the 8x rate, 72dB down from 0.45
+  static constexpr float STAGE_3[2] = {
+    2.835545008e-01f, -3.366726971e-02f
+  };
+};
+
+/*
+   One 2x stage in polyphase form, a 4K + 3 tap half-band filter with K + 1 stored coefficients.
+
+   Interpolating, the even outputs are the input through the short branch of nonzero taps and the odd
+   outputs are the input delayed to the centre tap. Decimating, the same branch runs on the even inputs
+   and the odd inputs only add the centre tap, so no zero is ever multiplied and nothing is computed
+   just to be thrown away. Both directions delay by 2K + 1 samples of the high rate.
+
+   Blocks are worked on in a line of history followed by the new samples, so every output reads its
+   window straight from one array.
+*/
+template <int K, const float (&COEFS)[K + 1]>
+class HalfBandStage {
+  public:
+    HalfBandStage() {
+      reset();
+    }
+
+    void reset(void) {
+      memset(upHistory, 0, sizeof(upHistory));
+      memset(evenHistory, 0, sizeof(evenHistory));
+      memset(oddHistory, 0, sizeof(oddHistory));
+    }
+
+    // n samples in, 2n out
+    void upsample(const float *in, float *out, int n) {
+      float line[HISTORY + MAX_SAMPLES];
+      memcpy(line, upHistory, sizeof(upHistory));
+      memcpy(line + HISTORY, in, n * sizeof(float));
+
+      for (int i = 0; i < n; ++i) {
+        out[2 * i] = 2 * branch(line + i);
+        out[2 * i + 1] = line[i + K + 1];
+      }
+
+      memcpy(upHistory, line + n, sizeof(upHistory));
+    }
+
+    // 2n samples in, n out
+    void downsample(const float *in, float *out, int n) {
+      float even[HISTORY + MAX_SAMPLES];
+      float odd[K + 1 + MAX_SAMPLES];
+      memcpy(even, evenHistory, sizeof(evenHistory));
+      memcpy(odd, oddHistory, sizeof(oddHistory));
+      for (int i = 0; i < n; ++i) {
+        even[HISTORY + i] = in[2 * i];
+        odd[K + 1 + i] = in[2 * i + 1];
+      }
+
+      for (int i = 0; i < n; ++i) {
+        out[i] = 0.5f * odd[i] + branch(even + i);
+      }
+
+      memcpy(evenHistory, even + n, sizeof(evenHistory));
+      memcpy(oddHistory, odd + n, sizeof(oddHistory));
+    }
+
+  private:
+    static const int HISTORY = 2 * K + 1;
+    static const int MAX_SAMPLES = AUDIO_BLOCK_SAMPLES * OVERSAMPLING_MAX / 2;
+
+    // the nonzero taps over the 2K + 2 samples from x, pairing the symmetric ones
+    static float branch(const float *x) {
+      float sum = 0;
+      for (int j = 0; j <= K; ++j) sum += COEFS[j] * (x[K + 1 + j] + x[K - j]);
+      return sum;
+    }
+
+    float upHistory[HISTORY];
+    float evenHistory[HISTORY];
+    float oddHistory[K + 1];
+};
+
+/*
+   Up to OVERSAMPLING_MAX times oversampling for a nonlinearity: upsample() a block, run the nonlinearity
+   over the result and downsample() it back. The factor can be changed at runtime, the stages are cascaded
+   2x half-band filters.
+
+   The oversampled block lives in a buffer shared by every oversampler. Audio updates never preempt each
+   other, so that is safe as long as the upsample()/downsample() pair runs inside one update.
+*/
+class HalfBandOversampler {
+  public:
+    // 1, 2, 4 or 8, others are rounded down to one of those. Clears the filters.
+    void setFactor(int factor);
+    int getFactor(void) const {
+      return factor;
+    }
+
+    // delay in samples at the base rate, rounded down
+    int getLatency(void) const {
+      return latency(factor);
+    }
+
+    static int roundFactor(int factor);
+    static int latency(int factor);
+
+    // AUDIO_BLOCK_SAMPLES in, getFactor() * AUDIO_BLOCK_SAMPLES out
+    float *upsample(const float *in);
+    // the block upsample() returned back down to AUDIO_BLOCK_SAMPLES
+    void downsample(float *out);
+
+  private:
+    int factor = 1;
+
+    HalfBandStage<9, HalfBandCoefficients::STAGE_1> stage1;
+    HalfBandStage<2, HalfBandCoefficients::STAGE_2> stage2;
+    HalfBandStage<1, HalfBandCoefficients::STAGE_3> stage3;
+
+    static float bufferA[AUDIO_BLOCK_SAMPLES * OVERSAMPLING_MAX];
+    static float bufferB[AUDIO_BLOCK_SAMPLES * OVERSAMPLING_MAX / 2];
+};
+
+#endif /* _HALF_BAND_OVERSAMPLER_H */
@@ -0,0 +1,104 @@
+#ifndef _LOOKAHEAD_DELAY_H
+#define _LOOKAHEAD_DELAY_H
+
+#include <Arduino.h>
+#include <AudioStream.h>
+#include <string.h>
+
+#include "FastMath.h"
+
+// power of two, holds LOOKAHEAD_MAX_MS up to 51.2kHz
+#define LOOKAHEAD_SIZE 256
+#define LOOKAHEAD_MIN_MS 0.1f
+#define LOOKAHEAD_MAX_MS 5.0f
+
+/*
+   Delay line plus sliding window peak for lookahead dynamics.
+
+   The audio is delayed by length samples while the detector gets, for every sample, the peak magnitude
+   of the length + 1 samples that are about to come out of the delay. A gain computer driven by that
+   peak has already reacted by the time a transient reaches the output.
+
+   The window peak comes from a monotonic deque of (sample, magnitude) pairs: new samples drop every
+   smaller entry from the back, expired ones leave at the front, and the front is always the peak. Each
+   sample goes in and out once, so it costs O(1) amortized per sample however long the window is.
+
+   Everything is sized statically, nothing is allocated.
+*/
+class LookaheadDelay {
+  public:
+    LookaheadDelay() {
+      setLength(0);
+    }
+
+    // delay in samples, 0 is off, clears the history
+    void setLength(int samples) {
+      length = samples < 0 ? 0 : (samples >= LOOKAHEAD_SIZE ? LOOKAHEAD_SIZE - 1 : samples);
+      memset(delay, 0, sizeof(delay));
+      pos = 0;
+      sampleIndex = 0;
+      head = tail = 0;
+    }
+
+    int getLength(void) const {
+      return length;
+    }
+
+    // the delay in samples for a time in ms, clamped to LOOKAHEAD_MIN_MS..LOOKAHEAD_MAX_MS, 0 ms is off
+    static int msToSamples(float ms, float sampleRate) {
+      if (ms <= 0) return 0;
+      ms = min(max(ms, LOOKAHEAD_MIN_MS), LOOKAHEAD_MAX_MS);
+      int samples = (int)(ms * 0.001f * sampleRate + 0.5f);
+      return min(max(samples, 1), LOOKAHEAD_SIZE - 1);
+    }
+
+    // delay AUDIO_BLOCK_SAMPLES in place and write the window peak for each output sample into peak
+    void process(float *data, float *peak) {
+      const uint32_t mask = LOOKAHEAD_SIZE - 1;
+      const uint32_t length = this->length;
+
+      int pos = this->pos;
+      uint32_t sampleIndex = this->sampleIndex;
+      uint32_t head = this->head;
+      uint32_t tail = this->tail;
+
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+        float x = data[i];
+        float level = fastAbs(x);
+
+        // drop the front once it has left the window, before the push, so a window of LOOKAHEAD_SIZE
+        // samples that only ever falls still fits
+        if (tail != head && sampleIndex - dequeSample[head & mask] > length) ++head;
+
+        // everything smaller than the new sample can never be the peak again
+        while (tail != head && dequeLevel[(tail - 1) & mask] <= level) --tail;
+        dequeLevel[tail & mask] = level;
+        dequeSample[tail & mask] = sampleIndex;
+        ++tail;
+
+        peak[i] = dequeLevel[head & mask];
+
+        delay[pos] = x;
+        data[i] = delay[(pos - length) & mask];
+        pos = (pos + 1) & mask;
+        ++sampleIndex;
+      }
+
+      this->pos = pos;
+      this->sampleIndex = sampleIndex;
+      this->head = head;
+      this->tail = tail;
+    }
+
+  private:
+    float delay[LOOKAHEAD_SIZE];
+    float dequeLevel[LOOKAHEAD_SIZE];
+    uint32_t dequeSample[LOOKAHEAD_SIZE];
+
+    int length;
+    int pos;
+    uint32_t sampleIndex;
+    uint32_t head, tail;
+};
+
+#endif /* _LOOKAHEAD_DELAY_H */
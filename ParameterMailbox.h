@@ -0,0 +1,55 @@
+#ifndef _PARAMETER_MAILBOX_H
+#define _PARAMETER_MAILBOX_H
+
+#include <Arduino.h>
+
+/*
+   Hands a complete set of coefficients from the control code to update() without disabling interrupts.
+
+   Triple buffer: the control side fills its own buffer and swaps it into the middle slot, update() swaps
+   the middle slot out at the start of a block when something new is there. Neither side ever touches the
+   buffer the other one owns, so a knob can be turned while a block is being processed and the block still
+   sees one consistent set of values.
+
+   One producer (the setters, called from loop()) and one consumer (update()).
+*/
+template <class T>
+class ParameterMailbox {
+  public:
+    // control side, the values are copied
+    void publish(const T &values) {
+      buffers[back] = values;
+      publish();
+    }
+
+    // control side, for sets too big to keep a second copy of: write every value of the buffer edit()
+    // returns, it holds whatever was published two or more times ago, then publish() it
+    T &edit(void) {
+      return buffers[back];
+    }
+    void publish(void) {
+      back = __atomic_exchange_n(&middle, (uint8_t)(back | NEW_DATA), __ATOMIC_ACQ_REL) & INDEX_MASK;
+    }
+
+    // audio side, true if publish() was called since the last read()
+    bool pending(void) {
+      return (__atomic_load_n(&middle, __ATOMIC_ACQUIRE) & NEW_DATA) != 0;
+    }
+
+    // audio side, the newest published values, stable until the next read()
+    const T &read(void) {
+      if (pending()) front = __atomic_exchange_n(&middle, front, __ATOMIC_ACQ_REL) & INDEX_MASK;
+      return buffers[front];
+    }
+
+  private:
+    static const uint8_t INDEX_MASK = 0x03;
+    static const uint8_t NEW_DATA = 0x04;
+
+    T buffers[3];
+    uint8_t front = 0;
+    uint8_t middle = 1;
+    uint8_t back = 2;
+};
+
+#endif /* _PARAMETER_MAILBOX_H */
@@ -0,0 +1,7 @@
+#include "RealFft.h"
+
+#define REAL_FFT_TABLES_DEFINE(BITS) \
+  template <> constexpr RealFftTables<BITS> RealFft<BITS>::TABLES PROGMEM = RealFftTables<BITS>();
+
+REAL_FFT_TABLES_DEFINE(7)
+REAL_FFT_TABLES_DEFINE(8)
@@ -0,0 +1,159 @@
+#ifndef _REAL_FFT_H
+#define _REAL_FFT_H
+
+#include <Arduino.h>
+
+#include "FastMathTables.h"
+
+// implementation methods not intended for general use, sin and cos on [0, pi] from the table series
+
+constexpr double _constSinHalfTurn(double x) {
+  return x <= 1.5707963267948966192 ? _constSin(x) : _constSin(3.1415926535897932385 - x);
+}
+
+constexpr double _constCosHalfTurn(double x) {
+  return x <= 1.5707963267948966192 ? _constSin(1.5707963267948966192 - x) : -_constSin(x - 1.5707963267948966192);
+}
+
+/*
+   Tables for a SIZE = 2^BITS point real FFT, built by the compiler like the FastMathTables ones.
+*/
+template <int BITS>
+struct RealFftTables {
+  static const int SIZE = 1 << BITS;
+  static const int HALF = SIZE / 2;
+
+  // cos and sin of 2 pi k / SIZE, the twiddles of the SIZE / 2 point complex FFT are every other one
+  float cosW[HALF], sinW[HALF];
+  // sin(pi n / SIZE), the square root of a periodic Hann window, which overlaps by half to exactly 1
+  float window[SIZE];
+  // where sample n goes for the decimation in time complex FFT
+  uint16_t bitReverse[HALF];
+
+  constexpr RealFftTables() : cosW(), sinW(), window(), bitReverse() {
+    for (int k = 0; k < HALF; ++k) {
+      cosW[k] = (float) _constCosHalfTurn(6.2831853071795864769 * k / SIZE);
+      sinW[k] = (float) _constSinHalfTurn(6.2831853071795864769 * k / SIZE);
+    }
+    for (int n = 0; n < SIZE; ++n) window[n] = (float) _constSinHalfTurn(3.1415926535897932385 * n / SIZE);
+    for (int n = 0; n < HALF; ++n) {
+      int reversed = 0;
+      for (int b = 0; b < BITS - 1; ++b) reversed |= ((n >> b) & 1) << (BITS - 2 - b);
+      bitReverse[n] = (uint16_t) reversed;
+    }
+  }
+};
+
+/*
+   FFT of SIZE = 2^BITS real samples, as a SIZE / 2 point complex FFT of the even and odd samples packed
+   into real and imaginary parts, then split into the SIZE / 2 + 1 bins of the real spectrum. Half the work
+   of a full size complex FFT, with no transcendental functions at run time: the twiddles, window and bit
+   reversal come from RealFftTables in flash.
+
+   The cost only depends on BITS, there are no data dependent branches. Radix 2, decimation in time, split
+   real and imaginary arrays so the butterflies over a stage's groups vectorize.
+*/
+template <int BITS>
+class RealFft {
+  public:
+    static const int SIZE = 1 << BITS;
+    static const int BINS = SIZE / 2 + 1;
+
+    static const RealFftTables<BITS> TABLES;
+
+    // SIZE samples to BINS bins in re and im, unscaled, im[0] and im[BINS - 1] are 0
+    static void forward(const float *in, float *re, float *im) {
+      const int half = SIZE / 2;
+      float zr[half], zi[half];
+
+      for (int n = 0; n < half; ++n) {
+        int r = TABLES.bitReverse[n];
+        zr[r] = in[2 * n];
+        zi[r] = in[2 * n + 1];
+      }
+      complexFft(zr, zi);
+
+      re[0] = zr[0] + zi[0];
+      im[0] = 0;
+      re[half] = zr[0] - zi[0];
+      im[half] = 0;
+
+      for (int k = 1; k < half; ++k) {
+        float a = zr[k], b = zi[k];
+        float c = zr[half - k], d = zi[half - k];
+
+        // the even samples' spectrum and the odd samples', which takes the twiddle
+        float evenRe = 0.5f * (a + c), evenIm = 0.5f * (b - d);
+        float oddRe = 0.5f * (b + d), oddIm = -0.5f * (a - c);
+        float wr = TABLES.cosW[k], ws = TABLES.sinW[k];
+
+        re[k] = evenRe + wr * oddRe + ws * oddIm;
+        im[k] = evenIm + wr * oddIm - ws * oddRe;
+      }
+    }
+
+    // BINS bins back to SIZE samples, scaled so that inverse(forward(x)) is x
+    static void inverse(const float *re, const float *im, float *out) {
+      const int half = SIZE / 2;
+      const float scale = 1.0f / half;
+      float zr[half], zi[half];
+
+      // the packed spectrum, conjugated into bit reversed order so the forward FFT runs it backwards
+      for (int k = 0; k < half; ++k) {
+        float a = re[k], b = im[k];
+        float c = re[half - k], d = im[half - k];
+
+        float evenRe = 0.5f * (a + c), evenIm = 0.5f * (b - d);
+        float p = 0.5f * (a - c), q = 0.5f * (b + d);
+        float wr = TABLES.cosW[k], ws = TABLES.sinW[k];
+        float oddRe = p * wr - q * ws, oddIm = p * ws + q * wr;
+
+        int r = TABLES.bitReverse[k];
+        zr[r] = evenRe - oddIm;
+        zi[r] = -(evenIm + oddRe);
+      }
+      complexFft(zr, zi);
+
+      for (int n = 0; n < half; ++n) {
+        out[2 * n] = zr[n] * scale;
+        out[2 * n + 1] = -zi[n] * scale;
+      }
+    }
+
+  private:
+    // SIZE / 2 point forward FFT in place, the input already in bit reversed order
+    static void complexFft(float *re, float *im) {
+      const int half = SIZE / 2;
+
+      for (int size = 2; size <= half; size *= 2) {
+        const int span = size / 2;
+        // W(SIZE / 2)^j is W(SIZE)^(2 j), SIZE / size entries apart in the tables
+        const int stride = SIZE / size;
+
+        for (int j = 0; j < span; ++j) {
+          float wr = TABLES.cosW[j * stride], ws = TABLES.sinW[j * stride];
+
+          for (int start = j; start < half; start += size) {
+            int top = start + span;
+            float tr = wr * re[top] + ws * im[top];
+            float ti = wr * im[top] - ws * re[top];
+            re[top] = re[start] - tr;
+            im[top] = im[start] - ti;
+            re[start] += tr;
+            im[start] += ti;
+          }
+        }
+      }
+    }
+};
+
+/*
+   Defined for each size in RealFft.cpp, see FAST_MATH_TABLE_DECLARE.
+*/
+#define REAL_FFT_TABLES_DECLARE(BITS) \
+  template <> const RealFftTables<BITS> RealFft<BITS>::TABLES;
+
+REAL_FFT_TABLES_DECLARE(7)
+REAL_FFT_TABLES_DECLARE(8)
+
+#endif /* _REAL_FFT_H */
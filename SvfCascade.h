@@ -0,0 +1,162 @@
+#ifndef _SVF_CASCADE_H
+#define _SVF_CASCADE_H
+
+#include <Arduino.h>
+#include <AudioStream.h>
+
+#include "FastMath.h"
+
+/*
+   Coefficients for a cascade of trapezoidal state variable filters (Andrew Simper, Cytomic).
+
+   g = tan(PI * freq / sampleRate) sets the frequency and k = 1 / Q the damping. The output is
+   m0 * input + m1 * band + m2 * low, which covers the low/high pass and peaking shapes the EQ needs.
+*/
+template <int SECTIONS>
+struct SvfCoefficients {
+  float g[SECTIONS], k[SECTIONS], m0[SECTIONS], m1[SECTIONS], m2[SECTIONS];
+
+  SvfCoefficients() {
+    for (int s = 0; s < SECTIONS; ++s) setSection(s, 0, 1, 1, 0, 0);
+  }
+
+  void setSection(int s, float g, float k, float m0, float m1, float m2) {
+    this->g[s] = g;
+    this->k[s] = k;
+    this->m0[s] = m0;
+    this->m1[s] = m1;
+    this->m2[s] = m2;
+  }
+
+  void setLowPass(int s, float g, float q) {
+    setSection(s, g, 1 / q, 0, 0, 1);
+  }
+
+  void setHighPass(int s, float g, float q) {
+    setSection(s, g, 1 / q, 1, -1 / q, -1);
+  }
+
+  // a is the RBJ amplitude, 10^(gain / 40)
+  void setPeaking(int s, float g, float q, float a) {
+    float k = 1 / (q * a);
+    setSection(s, g, k, 1, k * (a * a - 1), 0);
+  }
+};
+
+/*
+   Cascade of state variable filters with the state kept in arrays.
+
+   The state is two integrator charges rather than past outputs, so the filter stays well behaved while
+   g and k are swept sample by sample. That makes it the topology to use under heavy modulation.
+
+   CHANNELS channels share the coefficients, with their state side by side as in BiquadCascade.
+*/
+template <int SECTIONS, int CHANNELS = 1>
+class SvfCascade {
+  public:
+    SvfCascade() {
+      for (int s = 0; s < SECTIONS; ++s) reset(s);
+    }
+
+    void reset(int s) {
+      for (int ch = 0; ch < CHANNELS; ++ch) ic1eq[s][ch] = ic2eq[s][ch] = 0;
+    }
+
+    // filter AUDIO_BLOCK_SAMPLES of every channel in place through section s
+    void processSection(int s, const SvfCoefficients<SECTIONS> &c, float **data) {
+      float g = c.g[s];
+      float a1 = 1 / (1 + g * (g + c.k[s]));
+      float a2 = g * a1;
+      float a3 = g * a2;
+      float m0 = c.m0[s];
+      float m1 = c.m1[s];
+      float m2 = c.m2[s];
+
+      float *d[CHANNELS];
+      float ic1eq[CHANNELS], ic2eq[CHANNELS];
+      for (int ch = 0; ch < CHANNELS; ++ch) {
+        d[ch] = data[ch];
+        ic1eq[ch] = this->ic1eq[s][ch];
+        ic2eq[ch] = this->ic2eq[s][ch];
+      }
+
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+        for (int ch = 0; ch < CHANNELS; ++ch) {
+          float v0 = d[ch][i];
+          float v3 = v0 - ic2eq[ch];
+          float v1 = a1 * ic1eq[ch] + a2 * v3;
+          float v2 = ic2eq[ch] + a2 * ic1eq[ch] + a3 * v3;
+          ic1eq[ch] = 2 * v1 - ic1eq[ch];
+          ic2eq[ch] = 2 * v2 - ic2eq[ch];
+          d[ch][i] = m0 * v0 + m1 * v1 + m2 * v2;
+        }
+      }
+
+      // a decaying tail would otherwise end up recirculating denormals
+      storeState(s, ic1eq, ic2eq);
+    }
+
+    /*
+       Same as processSection() but g, k and the output mix move linearly from one set to the other across
+       the block. Costs a divide per sample for the feedback gain, no trig.
+    */
+    void processSectionRamp(int s, const SvfCoefficients<SECTIONS> &from, const SvfCoefficients<SECTIONS> &to,
+                            float **data) {
+      const float step = 1.0f / AUDIO_BLOCK_SAMPLES;
+
+      float g = from.g[s];
+      float k = from.k[s];
+      float m0 = from.m0[s];
+      float m1 = from.m1[s];
+      float m2 = from.m2[s];
+      float dg = (to.g[s] - g) * step;
+      float dk = (to.k[s] - k) * step;
+      float dm0 = (to.m0[s] - m0) * step;
+      float dm1 = (to.m1[s] - m1) * step;
+      float dm2 = (to.m2[s] - m2) * step;
+
+      float *d[CHANNELS];
+      float ic1eq[CHANNELS], ic2eq[CHANNELS];
+      for (int ch = 0; ch < CHANNELS; ++ch) {
+        d[ch] = data[ch];
+        ic1eq[ch] = this->ic1eq[s][ch];
+        ic2eq[ch] = this->ic2eq[s][ch];
+      }
+
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+        g += dg;
+        k += dk;
+        m0 += dm0;
+        m1 += dm1;
+        m2 += dm2;
+
+        float a1 = 1 / (1 + g * (g + k));
+        float a2 = g * a1;
+        float a3 = g * a2;
+
+        for (int ch = 0; ch < CHANNELS; ++ch) {
+          float v0 = d[ch][i];
+          float v3 = v0 - ic2eq[ch];
+          float v1 = a1 * ic1eq[ch] + a2 * v3;
+          float v2 = ic2eq[ch] + a2 * ic1eq[ch] + a3 * v3;
+          ic1eq[ch] = 2 * v1 - ic1eq[ch];
+          ic2eq[ch] = 2 * v2 - ic2eq[ch];
+          d[ch][i] = m0 * v0 + m1 * v1 + m2 * v2;
+        }
+      }
+
+      storeState(s, ic1eq, ic2eq);
+    }
+
+  private:
+    void storeState(int s, const float *ic1eq, const float *ic2eq) {
+      for (int ch = 0; ch < CHANNELS; ++ch) {
+        this->ic1eq[s][ch] = fastAbs(ic1eq[ch]) < C_DENORM ? 0 : ic1eq[ch];
+        this->ic2eq[s][ch] = fastAbs(ic2eq[ch]) < C_DENORM ? 0 : ic2eq[ch];
+      }
+    }
+
+    float ic1eq[SECTIONS][CHANNELS], ic2eq[SECTIONS][CHANNELS];
+};
+
+#endif /* _SVF_CASCADE_H */
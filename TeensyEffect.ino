@@ -1,5 +1,6 @@
 #include <Audio.h>
 
+#include "AudioFilterDenoiser.h"
 #include "AudioEffectTubeSaturation.h"
 #include "AudioEffectParametricEq.h"
 #include "AudioEffectGraphicEq.h"
@@ -9,6 +10,7 @@
 #include "AudioEffectExciter.h"
 #include "AudioFilterShelfEq.h"
 #include "AudioEffectOutputTransformer.h"
+#include "AudioConvertFloat.h"
 #include "FastMath.h"
 
 #define DEBUG
@@ -22,30 +24,67 @@ AudioControlSGTL5000 audioShield;
 //AudioInputAnalog         adc1;
 //AudioOutputAnalog        dac1;
 
-AudioEffectOpticalCompressor optComp;
+// Declared in signal order, the audio library updates objects in the order they were constructed.
+// The effects pass float blocks between each other, only the int16 stages need converting in and out.
+AudioConvertIntToFloat   toFloat;
+AudioFilterDenoiser      denoiser;
 AudioEffectTubeSaturation tubeSat;
+AudioConvertFloatToInt   toShelfEq;
+AudioFilterShelfEq shelfEq;
+AudioConvertIntToFloat   fromShelfEq;
+AudioEffectOpticalCompressor optComp;
 AudioEffectParametricEq paraEq;
+AudioConvertFloatToInt   toDbxComp;
 AudioEffectDbx160Comp dbxComp;
-AudioEffectExciter exciter;
+AudioConvertIntToFloat   fromDbxComp;
 AudioEffectFetCompressor fetComp;
-AudioFilterShelfEq shelfEq;
+AudioEffectExciter exciter;
 AudioEffectOutputTransformer outTrans;
-
-AudioConnection          patchCord1(audioInput, tubeSat);
-AudioConnection          patchCord2(tubeSat, shelfEq);
-AudioConnection          patchCord3(shelfEq, optComp);
-AudioConnection          patchCord4(optComp, paraEq);
-AudioConnection          patchCord5(paraEq, dbxComp);
-AudioConnection          patchCord6(dbxComp, fetComp);
-AudioConnection          patchCord7(fetComp, outTrans);
-//AudioConnection          patchCord8(exciter, outTrans);
-
-AudioConnection          outputL(outTrans, 0, audioOutput, 0);
-AudioConnection          outputR(outTrans, 0, audioOutput, 1);
+AudioConvertFloatToInt   toInt;
+
+AudioConnection          patchCord1(audioInput, toFloat);
+AudioConnectionFloat     patchCord2(toFloat, denoiser);
+AudioConnectionFloat     patchCord2a(denoiser, tubeSat);
+AudioConnectionFloat     patchCord3(tubeSat, toShelfEq);
+AudioConnection          patchCord4(toShelfEq, shelfEq);
+AudioConnection          patchCord5(shelfEq, fromShelfEq);
+AudioConnectionFloat     patchCord6(fromShelfEq, optComp);
+AudioConnectionFloat     patchCord7(optComp, paraEq);
+AudioConnectionFloat     patchCord8(paraEq, toDbxComp);
+AudioConnection          patchCord9(toDbxComp, dbxComp);
+AudioConnection          patchCord10(dbxComp, fromDbxComp);
+AudioConnectionFloat     patchCord11(fromDbxComp, fetComp);
+AudioConnectionFloat     patchCord12(fetComp, outTrans);
+AudioConnectionFloat     patchCord13(outTrans, toInt);
+//AudioConnectionFloat     patchCord14(exciter, outTrans);
+
+AudioConnection          outputL(toInt, 0, audioOutput, 0);
+
+#if NUM_CHANNELS > 1
+// the second channel (e.g. a mic next to the DI) runs through the same objects on their second input and output.
+// The shelf EQ and DBX 160 are mono, that channel is patched around them.
+AudioConnection          patchCord1b(audioInput, 1, toFloat, 1);
+AudioConnectionFloat     patchCord2b(toFloat, 1, denoiser, 1);
+AudioConnectionFloat     patchCord2ab(denoiser, 1, tubeSat, 1);
+AudioConnectionFloat     patchCord3b(tubeSat, 1, toShelfEq, 1);
+AudioConnection          patchCord5b(toShelfEq, 1, fromShelfEq, 1);
+AudioConnectionFloat     patchCord6b(fromShelfEq, 1, optComp, 1);
+AudioConnectionFloat     patchCord7b(optComp, 1, paraEq, 1);
+AudioConnectionFloat     patchCord8b(paraEq, 1, toDbxComp, 1);
+AudioConnection          patchCord10b(toDbxComp, 1, fromDbxComp, 1);
+AudioConnectionFloat     patchCord11b(fromDbxComp, 1, fetComp, 1);
+AudioConnectionFloat     patchCord12b(fetComp, 1, outTrans, 1);
+AudioConnectionFloat     patchCord13b(outTrans, 1, toInt, 1);
+
+AudioConnection          outputR(toInt, 1, audioOutput, 1);
+#else
+AudioConnection          outputR(toInt, 0, audioOutput, 1);
+#endif
 
 void setup() {
   Serial.begin(9600);
 
+  denoiser.init(SAMPLERATE);
   tubeSat.init(SAMPLERATE);
   paraEq.init(SAMPLERATE);
   optComp.init(SAMPLERATE);
@@ -56,6 +95,7 @@ void setup() {
 
   //  analogReference(INTERNAL);
   AudioMemory(32);
+  AudioMemoryFloat(16);
 
   // Enable the audio shield and set the output volume.
   audioShield.enable();
@@ -63,6 +103,9 @@ void setup() {
   audioShield.inputSelect(AUDIO_INPUT_LINEIN);
   audioShield.volume(0.9);
 
+  // learn the pickup's hum and hiss while the strings are still muted after power up
+  denoiser.captureNoise(1.0);
+
 //  audioShield.audioPostProcessorEnable();
 //  audioShield.enhanceBassEnable(); // all we need to do for default bass enhancement settings.
 //  audioShield.enhanceBass(5, 127);
@@ -139,27 +182,50 @@ void sqrtTest() {
 }
 
 
+void printProfile(const char *name, const EffectProfile &profile) {
+  Serial.print(name);
+  Serial.print(" blocks: ");
+  Serial.print(profile.blocks);
+  Serial.print("  min/mean/p99/max %: ");
+  Serial.print(EffectProfiler::ticksToPercent(profile.minTicks));
+  Serial.print(" / ");
+  Serial.print(EffectProfiler::ticksToPercent(profile.meanTicks));
+  Serial.print(" / ");
+  Serial.print(EffectProfiler::ticksToPercent(profile.p99Ticks));
+  Serial.print(" / ");
+  Serial.print(EffectProfiler::ticksToPercent(profile.maxTicks));
+  Serial.print("  max ever us: ");
+  Serial.println(EffectProfiler::ticksToMicros(profile.maxTicksEver));
+}
+
 void testEffectCpu() {
-  Serial.print("ParametricEq CPU: ");
-  Serial.println(paraEq.processorUsage());
+  EffectProfile profile;
+
+  paraEq.getProfile(profile);
+  printProfile("ParametricEq", profile);
+
+  tubeSat.getProfile(profile);
+  printProfile("Tube Saturation", profile);
 
-  Serial.print("Tube Saturation CPU: ");
-  Serial.println(tubeSat.processorUsageMax());
+  optComp.getProfile(profile);
+  printProfile("Optical Compressor", profile);
 
-  Serial.print("Optical Compressor CPU: ");
-  Serial.println(optComp.processorUsageMax());
+  fetComp.getProfile(profile);
+  printProfile("Fet Compressor", profile);
 
-  Serial.print("Fet Compressor CPU: ");
-  Serial.println(fetComp.processorUsageMax());
+  exciter.getProfile(profile);
+  printProfile("Exciter", profile);
+
+  outTrans.getProfile(profile);
+  printProfile("Output Transformer", profile);
 
   Serial.print("DBX 160 Compressor CPU: ");
   Serial.println(dbxComp.processorUsageMax());
 
-  Serial.print("Exciter CPU: ");
-  Serial.println(exciter.processorUsage());
-
-  Serial.print("Output Transformer CPU: ");
-  Serial.println(outTrans.processorUsage());
+  Serial.print("Total CPU: ");
+  Serial.print(AudioProcessorUsage());
+  Serial.print("  max: ");
+  Serial.println(AudioProcessorUsageMax());
 
   Serial.println();
 }
@@ -183,7 +249,7 @@ void testMath() {
   Serial.print("   ms: ");
   Serial.println(end - start);
 
-
+  start = millis();
   for (long i = 0; i < loops; ++i) {
     r = random(2);
     root = sqrtf(r);
@@ -373,7 +439,28 @@ void testMath() {
   Serial.println();
 }
 
+void printLevels(const char *name, const DynamicsLevels &levels) {
+  Serial.print(name);
+  Serial.print(" in peak/rms dB: ");
+  Serial.print(DynamicsMeter::toDb(levels.peakIn[0]));
+  Serial.print(" / ");
+  Serial.print(DynamicsMeter::toDb(levels.rmsIn[0]));
+  Serial.print("  out peak/rms dB: ");
+  Serial.print(DynamicsMeter::toDb(levels.peakOut[0]));
+  Serial.print(" / ");
+  Serial.print(DynamicsMeter::toDb(levels.rmsOut[0]));
+  Serial.print("  gain reduction max/mean dB: ");
+  Serial.print(DynamicsMeter::toDb(levels.minGain[0]));
+  Serial.print(" / ");
+  Serial.println(DynamicsMeter::toDb(levels.meanGain[0]));
+}
+
 void showPluginData() {
-  Serial.print("OptComp gain reduction: ");
-  Serial.println(optComp.getGainReduction());
+  DynamicsLevels levels;
+
+  optComp.getLevels(levels);
+  printLevels("OptComp", levels);
+
+  fetComp.getLevels(levels);
+  printLevels("FetComp", levels);
 }
@@ -0,0 +1,59 @@
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+/*
+   Minimal stand-in for the Teensyduino core so the effect sources can be compiled and run on a desktop.
+   Only the pieces the effects actually use are provided.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <type_traits>
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+
+typedef bool boolean;
+
+// there are no interrupts on the host, the audio "ISR" runs on the calling thread
+#define __disable_irq()
+#define __enable_irq()
+
+// same semantics as the Teensyduino templates, mixed int/float arguments promote like the ternary would
+template <class A, class B>
+inline typename std::common_type<A, B>::type min(A a, B b) {
+  return a < b ? a : b;
+}
+
+template <class A, class B>
+inline typename std::common_type<A, B>::type max(A a, B b) {
+  return a > b ? a : b;
+}
+
+uint32_t millis(void);
+uint32_t micros(void);
+
+/*
+   Serial output is swallowed on the host. Some setters print their coefficients and those
+   should not end up in the middle of the renderer's report.
+*/
+class HostSerial {
+  public:
+    void begin(long baud) {}
+    template <class T> size_t print(const T &value) {
+      return 0;
+    }
+    template <class T> size_t println(const T &value) {
+      return 0;
+    }
+    size_t println(void) {
+      return 0;
+    }
+};
+
+extern HostSerial Serial;
+
+#endif /* _HOST_ARDUINO_H */
@@ -0,0 +1,39 @@
+#include <string.h>
+
+#include "AudioHostIo.h"
+
+void AudioHostInput::setSource(const int16_t *samples, size_t length) {
+  this->samples = samples;
+  this->length = length;
+  this->position = 0;
+}
+
+void AudioHostInput::update(void) {
+  audio_block_t *block = allocate();
+  if (block == NULL) return;
+
+  size_t count = 0;
+  if (position < length) {
+    count = min(length - position, (size_t)AUDIO_BLOCK_SAMPLES);
+    memcpy(block->data, samples + position, count * sizeof(int16_t));
+    position += count;
+  }
+  memset(block->data + count, 0, (AUDIO_BLOCK_SAMPLES - count) * sizeof(int16_t));
+
+  transmit(block);
+  release(block);
+}
+
+void AudioHostOutput::update(void) {
+  audio_block_t *block = receiveReadOnly();
+
+  if (block == NULL) {
+    // the I2S output plays silence when it is starved
+    if (firstBlock >= 0) samples.insert(samples.end(), AUDIO_BLOCK_SAMPLES, 0);
+  } else {
+    if (firstBlock < 0) firstBlock = updates;
+    samples.insert(samples.end(), block->data, block->data + AUDIO_BLOCK_SAMPLES);
+    release(block);
+  }
+  ++updates;
+}
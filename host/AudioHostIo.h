@@ -0,0 +1,55 @@
+#ifndef _HOST_AUDIO_HOST_IO_H
+#define _HOST_AUDIO_HOST_IO_H
+
+#include <vector>
+
+#include <AudioStream.h>
+
+/*
+   Stand-ins for AudioInputI2S/AudioOutputI2S that read from and write to memory.
+   The input sends silence once its source runs out so the chain can be flushed.
+*/
+class AudioHostInput : public AudioStream
+{
+  public:
+    AudioHostInput() : AudioStream(0, NULL) {
+      // any extra initialization
+    }
+    virtual void update(void);
+
+    void setSource(const int16_t *samples, size_t length);
+    bool isFinished(void) {
+      return position >= length;
+    }
+
+  private:
+    const int16_t *samples = NULL;
+    size_t length = 0;
+    size_t position = 0;
+};
+
+class AudioHostOutput : public AudioStream
+{
+  public:
+    AudioHostOutput() : AudioStream(1, inputQueueArray) {
+      // any extra initialization
+    }
+    virtual void update(void);
+
+    // blocks that went by before the first real block arrived, i.e. the latency of the patch in blocks
+    int latencyBlocks(void) {
+      return firstBlock < 0 ? 0 : firstBlock;
+    }
+    std::vector<int16_t> &getSamples(void) {
+      return samples;
+    }
+
+  private:
+    audio_block_t *inputQueueArray[1];
+
+    std::vector<int16_t> samples;
+    int updates = 0;
+    int firstBlock = -1;
+};
+
+#endif /* _HOST_AUDIO_HOST_IO_H */
@@ -0,0 +1,146 @@
+#include <chrono>
+#include <string.h>
+
+#include "AudioStream.h"
+
+AudioStream *AudioStream::first_update = NULL;
+audio_block_t *AudioStream::memory_pool = NULL;
+audio_block_t **AudioStream::memory_free = NULL;
+unsigned int AudioStream::memory_free_count = 0;
+uint16_t AudioStream::memory_used = 0;
+uint16_t AudioStream::memory_used_max = 0;
+float AudioStream::block_nanos = AUDIO_BLOCK_SAMPLES * 1.0e9f / AUDIO_SAMPLE_RATE;
+
+AudioStream::AudioStream(unsigned char ninput, audio_block_t **iqueue) :
+  active(false), num_inputs(ninput), destination_list(NULL), inputQueue(iqueue), next_update(NULL),
+  cpu_nanos(0), cpu_nanos_max(0), cpu_nanos_total(0), update_count(0) {
+
+  for (int i = 0; i < num_inputs; ++i) inputQueue[i] = NULL;
+
+  // append to the update list, the Teensy updates in construction order too
+  if (first_update == NULL) {
+    first_update = this;
+  } else {
+    AudioStream *p = first_update;
+    while (p->next_update) p = p->next_update;
+    p->next_update = this;
+  }
+}
+
+AudioConnection::AudioConnection(AudioStream &source, AudioStream &destination) :
+  AudioConnection(source, 0, destination, 0) {
+}
+
+AudioConnection::AudioConnection(AudioStream &source, unsigned char sourceOutput,
+                                 AudioStream &destination, unsigned char destinationInput) :
+  src(source), dst(destination), src_index(sourceOutput), dest_index(destinationInput), next_dest(NULL) {
+
+  if (source.destination_list == NULL) {
+    source.destination_list = this;
+  } else {
+    AudioConnection *p = source.destination_list;
+    while (p->next_dest) p = p->next_dest;
+    p->next_dest = this;
+  }
+  source.active = true;
+  destination.active = true;
+}
+
+void AudioStream::initialize_memory(audio_block_t *data, unsigned int num) {
+  delete[] memory_free;
+  memory_pool = data;
+  memory_free = new audio_block_t *[num];
+  memory_free_count = num;
+  memory_used = 0;
+  memory_used_max = 0;
+
+  // hand out the lowest blocks first
+  for (unsigned int i = 0; i < num; ++i) {
+    data[i].memory_pool_index = i;
+    memory_free[num - 1 - i] = data + i;
+  }
+}
+
+void AudioStream::setSampleRate(float sampleRate) {
+  block_nanos = AUDIO_BLOCK_SAMPLES * 1.0e9f / sampleRate;
+}
+
+audio_block_t *AudioStream::allocate(void) {
+  if (memory_free_count == 0) return NULL;
+
+  audio_block_t *block = memory_free[--memory_free_count];
+  block->ref_count = 1;
+  if (++memory_used > memory_used_max) memory_used_max = memory_used;
+  return block;
+}
+
+void AudioStream::release(audio_block_t *block) {
+  if (block == NULL) return;
+
+  if (block->ref_count > 1) {
+    --block->ref_count;
+  } else {
+    block->ref_count = 0;
+    memory_free[memory_free_count++] = block;
+    --memory_used;
+  }
+}
+
+void AudioStream::transmit(audio_block_t *block, unsigned char index) {
+  for (AudioConnection *c = destination_list; c != NULL; c = c->next_dest) {
+    if (c->src_index == index && c->dst.inputQueue[c->dest_index] == NULL) {
+      c->dst.inputQueue[c->dest_index] = block;
+      ++block->ref_count;
+    }
+  }
+}
+
+audio_block_t *AudioStream::receiveReadOnly(unsigned int index) {
+  if (index >= num_inputs) return NULL;
+
+  audio_block_t *in = inputQueue[index];
+  inputQueue[index] = NULL;
+  return in;
+}
+
+audio_block_t *AudioStream::receiveWritable(unsigned int index) {
+  if (index >= num_inputs) return NULL;
+
+  audio_block_t *in = inputQueue[index];
+  inputQueue[index] = NULL;
+  if (in && in->ref_count > 1) {
+    audio_block_t *p = allocate();
+    if (p) memcpy(p->data, in->data, sizeof(p->data));
+    --in->ref_count;
+    in = p;
+  }
+  return in;
+}
+
+float AudioStream::processorUsage(void) {
+  return cpu_nanos * 100.0f / block_nanos;
+}
+
+float AudioStream::processorUsageMax(void) {
+  return cpu_nanos_max * 100.0f / block_nanos;
+}
+
+void AudioStream::processorUsageMaxReset(void) {
+  cpu_nanos_max = cpu_nanos;
+}
+
+void AudioStream::update_all(void) {
+  for (AudioStream *p = first_update; p != NULL; p = p->next_update) {
+    if (!p->active) continue;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    p->update();
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    uint32_t nanos = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    p->cpu_nanos = nanos;
+    if (nanos > p->cpu_nanos_max) p->cpu_nanos_max = nanos;
+    p->cpu_nanos_total += nanos;
+    ++p->update_count;
+  }
+}
@@ -0,0 +1,109 @@
+#ifndef _HOST_AUDIO_STREAM_H
+#define _HOST_AUDIO_STREAM_H
+
+/*
+   Host stand-in for the Teensy Audio library's AudioStream.
+
+   Keeps the same block/reference counting/update list semantics as the real thing:
+    - streams are updated in the order they were constructed
+    - transmit() hands the block to every connected input with ref counting
+    - a connection to a stream that was already updated this cycle adds one block of latency
+   The update cost is measured with a steady clock instead of the cycle counter.
+*/
+
+#include <Arduino.h>
+
+#define AUDIO_BLOCK_SAMPLES 128
+#define AUDIO_SAMPLE_RATE_EXACT 44117.64706f
+#define AUDIO_SAMPLE_RATE AUDIO_SAMPLE_RATE_EXACT
+
+typedef struct audio_block_struct {
+  uint8_t ref_count;
+  uint8_t reserved1;
+  uint16_t memory_pool_index;
+  int16_t data[AUDIO_BLOCK_SAMPLES];
+} audio_block_t;
+
+class AudioStream;
+
+class AudioConnection {
+  public:
+    AudioConnection(AudioStream &source, AudioStream &destination);
+    AudioConnection(AudioStream &source, unsigned char sourceOutput, AudioStream &destination, unsigned char destinationInput);
+
+  private:
+    AudioStream &src;
+    AudioStream &dst;
+    unsigned char src_index;
+    unsigned char dest_index;
+    AudioConnection *next_dest;
+
+    friend class AudioStream;
+};
+
+#define AudioMemory(num) ({ \
+    static audio_block_t data[num]; \
+    AudioStream::initialize_memory(data, num); \
+  })
+
+class AudioStream {
+  public:
+    AudioStream(unsigned char ninput, audio_block_t **iqueue);
+    virtual ~AudioStream() {}
+
+    // percent of one block period at the configured sample rate, same scale as on the Teensy
+    float processorUsage(void);
+    float processorUsageMax(void);
+    void processorUsageMaxReset(void);
+
+    // host only, for throughput reports
+    uint64_t processorNanosTotal(void) {
+      return cpu_nanos_total;
+    }
+    uint32_t updateCount(void) {
+      return update_count;
+    }
+
+    bool isActive(void) {
+      return active;
+    }
+
+    static void initialize_memory(audio_block_t *data, unsigned int num);
+    static void setSampleRate(float sampleRate);
+    static void update_all(void);
+
+    static uint16_t memory_used;
+    static uint16_t memory_used_max;
+
+  protected:
+    bool active;
+    unsigned char num_inputs;
+
+    static audio_block_t *allocate(void);
+    static void release(audio_block_t *block);
+    void transmit(audio_block_t *block, unsigned char index = 0);
+    audio_block_t *receiveReadOnly(unsigned int index = 0);
+    audio_block_t *receiveWritable(unsigned int index = 0);
+
+    virtual void update(void) = 0;
+
+  private:
+    AudioConnection *destination_list;
+    audio_block_t **inputQueue;
+    AudioStream *next_update;
+
+    uint32_t cpu_nanos;
+    uint32_t cpu_nanos_max;
+    uint64_t cpu_nanos_total;
+    uint32_t update_count;
+
+    static AudioStream *first_update;
+    static audio_block_t *memory_pool;
+    static audio_block_t **memory_free;
+    static unsigned int memory_free_count;
+    static float block_nanos;
+
+    friend class AudioConnection;
+};
+
+#endif /* _HOST_AUDIO_STREAM_H */
@@ -0,0 +1,19 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include <Arduino.h>
+#include "BenchSignal.h"
+
+void makeLevelSteps(float *signal, long samples, float sampleRate) {
+  static const float levels[] = { 0.03f, 0.5f, 0.1f, 0.9f, 0.02f, 0.3f };
+  long section = (long)(sampleRate / 4);
+
+  srand(1234);
+  for (long i = 0; i < samples; ++i) {
+    long s = i / section;
+    float level = levels[s % (sizeof(levels) / sizeof(levels[0]))];
+    float tone = sinf(TWO_PI * 220.0f * i / sampleRate) + 0.5f * sinf(TWO_PI * 1375.0f * i / sampleRate);
+    float noise = 2.0f * rand() / (float)RAND_MAX - 1;
+    signal[i] = level * (s & 1 ? noise : 0.66f * tone);
+  }
+}
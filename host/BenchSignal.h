@@ -0,0 +1,12 @@
+#ifndef _HOST_BENCH_SIGNAL_H
+#define _HOST_BENCH_SIGNAL_H
+
+/*
+   Test signals shared by the benches.
+*/
+
+// bursts of tone and noise that change level every quarter second, on the float scale (1.0 is full scale).
+// Quiet, moderate and hot passages, so a compressor attacks, releases and sits at different gains.
+void makeLevelSteps(float *signal, long samples, float sampleRate);
+
+#endif /* _HOST_BENCH_SIGNAL_H */
@@ -0,0 +1,273 @@
+/*
+   The spectral noise gate and the expander on a noisy test signal: how transparent the spectral gate is
+   before it has learned a floor, how far each pulls the noise down, and what a block costs.
+
+   The noise is mains hum (60 Hz and its harmonics, like a single coil pickup) plus white hiss. The signal
+   is a plucked note with harmonics every half second, with gaps of noise alone between the notes. The
+   first second is noise alone, the gated instance captures its floor from there.
+
+   Transparent: a denoiser that never captured anything against the input delayed by getLatency(), the
+   SNR of the difference, which is only the FFT's rounding. Noise: the noise power in the second half of
+   the gaps after the capture, once the gate has closed, gated against ungated, in dB. Note: the SNR of
+   the note against the noise, before and after. The expander runs alone with its threshold between the
+   noise and the notes. Its noise reduction is over the same second half of the gaps, where it should have
+   muted the blocks outright but for the block a note starts in.
+
+   Downstream: the expander patched into an optical compressor, on a held note that stops dead, a gap
+   longer than the expander's hold and release, and the note again. The muting expander's blocks never
+   reach the compressor, which has to keep releasing on its own. The gain reduction over the second
+   onset is compared with a chain whose expander closes just short of muting, so every block goes through.
+
+   Fails if the transparent SNR is below MIN_TRANSPARENT_DB, the spectral gate pulls the noise down less
+   than MIN_REDUCTION_DB, the expander less than MIN_GATE_REDUCTION_DB, or it never mutes a block, or if
+   the compressor behind it is off by more than MAX_ONSET_ERROR_DB at the onset.
+
+   usage: denoiser_bench [blocks]
+*/
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <Arduino.h>
+#include "AudioHostIo.h"
+#include "../AudioFilterDenoiser.h"
+#include "../AudioEffectOpticalCompressor.h"
+
+#define MIN_TRANSPARENT_DB 100.0
+#define MIN_REDUCTION_DB 12.0
+#define MIN_GATE_REDUCTION_DB 20.0
+#define MAX_ONSET_ERROR_DB 0.1
+
+// the downstream check, the note's length and the gap's, and how many blocks from the onset are compared
+#define STOP_START_SECONDS 0.5f
+#define ONSET_BLOCKS 16
+
+#define CAPTURE_SECONDS 0.5f
+
+// noise alone for the first second, then notes in the first half of every other half second
+static void makeSignal(float *clean, float *noisy, long samples, float sampleRate) {
+  static const float harmonics[] = { 1, 0.5f, 0.3f, 0.2f, 0.1f };
+  long note = (long)(sampleRate / 2);
+
+  srand(1234);
+  for (long i = 0; i < samples; ++i) {
+    float t = i / sampleRate;
+    float hum = 0.004f * sinf(TWO_PI * 60 * t) + 0.002f * sinf(TWO_PI * 120 * t) + 0.001f * sinf(TWO_PI * 180 * t);
+    float hiss = 0.002f * (2.0f * rand() / (float)RAND_MAX - 1);
+
+    float spl = 0;
+    long n = i / note;
+    long position = i % note;
+    if (i >= sampleRate && !(n & 1)) {
+      float tn = position / sampleRate;
+      float freq = 110.0f * (1 + (n / 2) % 4);
+      float envelope = 0.3f * expf(-6 * tn);
+      for (size_t h = 0; h < sizeof(harmonics) / sizeof(harmonics[0]); ++h) {
+        spl += envelope * harmonics[h] * sinf(TWO_PI * freq * (h + 1) * tn);
+      }
+    }
+
+    clean[i] = spl;
+    noisy[i] = spl + hum + hiss;
+  }
+}
+
+// a held note that stops dead and comes back after a gap of hiss
+static void makeStopStart(int16_t *signal, long samples, float sampleRate) {
+  long length = (long)(STOP_START_SECONDS * sampleRate);
+
+  srand(1234);
+  for (long i = 0; i < samples; ++i) {
+    float hiss = 0.002f * (2.0f * rand() / (float)RAND_MAX - 1);
+    float note = (i / length) & 1 ? 0 : 0.5f * sinf(TWO_PI * 220.0f * i / sampleRate);
+    signal[i] = (int16_t)((note + hiss) * 32767);
+  }
+}
+
+static double nanosSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+// input through the denoiser block by block into output, every channel the same, the cost per block.
+// Counts the blocks that came out muted.
+static double run(AudioFilterDenoiser &denoiser, const float *in, float *out, long blocks, long &muted) {
+  double nanos = 0;
+  muted = 0;
+
+  for (long b = 0; b < blocks; ++b) {
+    float data[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+    float *channels[NUM_CHANNELS];
+
+    for (int c = 0; c < NUM_CHANNELS; ++c) {
+      channels[c] = data[c];
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) data[c][i] = in[b * AUDIO_BLOCK_SAMPLES + i];
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    denoiser.process(channels);
+    nanos += nanosSince(start);
+
+    bool zero = true;
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      out[b * AUDIO_BLOCK_SAMPLES + i] = data[0][i];
+      zero &= data[0][i] == 0;
+    }
+    muted += zero;
+  }
+
+  return nanos / blocks;
+}
+
+static double powerDb(double power) {
+  return 10 * log10(power + 1e-30);
+}
+
+// every AudioStream stays on the update list for good, in construction order
+static AudioFilterDenoiser transparent, gated, expander;
+static AudioHostInput stopStart;
+static AudioFilterDenoiser mutingGate, rangeGate;
+static AudioEffectOpticalCompressor mutingComp, rangeComp;
+
+/**
+   The downstream check, the worst difference in the compressors' mean gain reduction over the first
+   ONSET_BLOCKS blocks of the second note, and the reduction at the onset in the reference chain.
+   Counts the blocks the muting expander closed fully.
+*/
+static double runDownstream(float sampleRate, double &onsetDb, long &muted) {
+  long onset = (long)(2 * STOP_START_SECONDS * sampleRate);
+  long blocks = onset / AUDIO_BLOCK_SAMPLES + ONSET_BLOCKS;
+  std::vector<int16_t> signal(blocks * AUDIO_BLOCK_SAMPLES);
+  makeStopStart(signal.data(), signal.size(), sampleRate);
+
+  new AudioConnection(stopStart, mutingGate);
+  new AudioConnection(stopStart, rangeGate);
+  new AudioConnection(mutingGate, mutingComp);
+  new AudioConnection(rangeGate, rangeComp);
+  AudioMemory(16);
+
+  AudioFilterDenoiser *gates[] = { &mutingGate, &rangeGate };
+  for (AudioFilterDenoiser *gate : gates) {
+    gate->init(sampleRate);
+    gate->setMode(DenoiserExpander);
+    gate->setGateThresholdDb(-30);
+  }
+  rangeGate.setGateRangeDb(DENOISER_GATE_MUTE_DB - 1);
+
+  mutingComp.init(sampleRate);
+  mutingComp.setThresholdDb(-20);
+  rangeComp.init(sampleRate);
+  rangeComp.setThresholdDb(-20);
+
+  stopStart.setSource(signal.data(), signal.size());
+
+  double error = 0;
+  muted = 0;
+  onsetDb = 0;
+  for (long b = 0; b < blocks; ++b) {
+    AudioStream::update_all();
+
+    DynamicsLevels gate, muting, range;
+    mutingGate.getLevels(gate);
+    muted += gate.minGain[0] == 0 && gate.meanGain[0] == 0;
+
+    if (b < onset / AUDIO_BLOCK_SAMPLES) continue;
+    mutingComp.getLevels(muting);
+    rangeComp.getLevels(range);
+    double mutingDb = DynamicsMeter::toDb(muting.meanGain[0]);
+    double rangeDb = DynamicsMeter::toDb(range.meanGain[0]);
+    if (b == onset / AUDIO_BLOCK_SAMPLES) onsetDb = rangeDb;
+    error = max(error, fabs(mutingDb - rangeDb));
+  }
+
+  return error;
+}
+
+int main(int argc, char **argv) {
+  long blocks = argc > 1 ? atol(argv[1]) : 4000;
+  const float sampleRate = AUDIO_SAMPLE_RATE_EXACT;
+  const long samples = blocks * AUDIO_BLOCK_SAMPLES;
+  const long start = (long)sampleRate;
+  const int latency = AudioFilterDenoiser::HOP;
+
+  if (samples < 2 * start) {
+    printf("needs at least %ld blocks\n", 2 * start / AUDIO_BLOCK_SAMPLES);
+    return 1;
+  }
+
+  std::vector<float> clean(samples), noisy(samples), out(samples), gatedOut(samples), expanderOut(samples);
+  makeSignal(clean.data(), noisy.data(), samples, sampleRate);
+  long muted;
+
+  transparent.init(sampleRate);
+  transparent.setMode(DenoiserSpectral);
+  double transparentNanos = run(transparent, noisy.data(), out.data(), blocks, muted);
+
+  gated.init(sampleRate);
+  gated.setMode(DenoiserSpectral);
+  gated.captureNoise(CAPTURE_SECONDS);
+  double gatedNanos = run(gated, noisy.data(), gatedOut.data(), blocks, muted);
+
+  expander.init(sampleRate);
+  expander.setMode(DenoiserExpander);
+  expander.setGateThresholdDb(-30);
+  double expanderNanos = run(expander, noisy.data(), expanderOut.data(), blocks, muted);
+
+  double onsetDb;
+  long downstreamMuted;
+  double onsetErrorDb = runDownstream(sampleRate, onsetDb, downstreamMuted);
+
+  // from the first note on, output sample i is input sample i - latency
+  double signal = 0, error = 0;
+  double noiseIn = 0, noiseOut = 0;
+  double gapOut = 0;
+  double cleanPower = 0, noteErrorIn = 0, noteErrorOut = 0;
+  for (long i = start; i < samples; ++i) {
+    double x = noisy[i - latency];
+    signal += x * x;
+    error += (out[i] - x) * (out[i] - x);
+
+    double s = clean[i - latency];
+    bool note = !(((i - latency) / (long)(sampleRate / 2)) & 1);
+    if (note) {
+      cleanPower += s * s;
+      noteErrorIn += (x - s) * (x - s);
+      noteErrorOut += (gatedOut[i] - s) * (gatedOut[i] - s);
+    } else if ((i - latency) % (long)(sampleRate / 2) >= (long)(sampleRate / 4)) {
+      noiseIn += x * x;
+      noiseOut += gatedOut[i] * gatedOut[i];
+
+      // the expander adds no latency
+      gapOut += expanderOut[i - latency] * expanderOut[i - latency];
+    }
+  }
+
+  double transparentDb = powerDb(signal) - powerDb(error);
+  double reductionDb = powerDb(noiseIn) - powerDb(noiseOut);
+  double gateReductionDb = powerDb(noiseIn) - powerDb(gapOut);
+
+  printf("FFT size %d, latency %d samples, capture %.1f s, still capturing: %s\n", AudioFilterDenoiser::FFT_SIZE,
+         latency, CAPTURE_SECONDS, gated.isCapturingNoise() ? "yes" : "no");
+  printf("%-22s %10.1f dB%s\n", "transparent SNR", transparentDb, transparentDb < MIN_TRANSPARENT_DB ? "  LOW" : "");
+  printf("%-22s %10.1f dB%s\n", "noise reduction", reductionDb, reductionDb < MIN_REDUCTION_DB ? "  LOW" : "");
+  printf("%-22s %10.1f dB -> %.1f dB\n", "note SNR", powerDb(cleanPower) - powerDb(noteErrorIn),
+         powerDb(cleanPower) - powerDb(noteErrorOut));
+  printf("%-22s %10.1f ns/block ungated, %.1f gated\n", "cost", transparentNanos, gatedNanos);
+  if (gapOut == 0) {
+    printf("%-22s %10s\n", "expander reduction", "muted");
+  } else {
+    printf("%-22s %10.1f dB%s\n", "expander reduction", gateReductionDb,
+           gateReductionDb < MIN_GATE_REDUCTION_DB ? "  LOW" : "");
+  }
+  printf("%-22s %10ld of %ld%s\n", "expander muted blocks", muted, blocks, muted == 0 ? "  NONE" : "");
+  printf("%-22s %10.1f ns/block\n", "expander cost", expanderNanos);
+  printf("%-22s %10.2f dB, %.3f dB off after %ld muted blocks%s\n", "downstream onset gr", onsetDb,
+         onsetErrorDb, downstreamMuted, onsetErrorDb > MAX_ONSET_ERROR_DB || downstreamMuted == 0 ? "  OFF" : "");
+
+  return transparentDb < MIN_TRANSPARENT_DB || reductionDb < MIN_REDUCTION_DB || gated.isCapturingNoise() ||
+         gateReductionDb < MIN_GATE_REDUCTION_DB || muted == 0 || onsetErrorDb > MAX_ONSET_ERROR_DB ||
+         downstreamMuted == 0 ? 1 : 0;
+}
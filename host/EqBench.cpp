@@ -0,0 +1,90 @@
+/*
+   Parametric EQ cost per block for loud, very quiet and silent input.
+
+   Denormal arithmetic is many times slower than normal on x86, so a filter that lets its state decay
+   into the denormal range shows up as silence costing far more than signal. Every input is timed with
+   the FPU left alone first, so the filters' own state flushing is what keeps the numbers flat, and then
+   again after enableFlushToZero().
+
+   Fails if any quiet input costs more than SLOWDOWN_LIMIT times the loud one.
+
+   usage: eq_bench [blocks]
+*/
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Arduino.h>
+#include "../AudioEffectParametricEq.h"
+#include "../FastMath.h"
+
+#define SLOWDOWN_LIMIT 1.5
+
+enum Input {
+  LoudNoise, QuietNoise, SilentTail, NUM_INPUTS
+};
+
+static const char *inputNames[NUM_INPUTS] = { "noise -20 dBFS", "noise -140 dBFS", "silence" };
+static const char *topologyNames[] = { "biquad", "state variable" };
+
+// white noise at the given level, or silence after a loud block so the filters have a tail to decay
+static void fill(Input input, float *data, long block) {
+  float level = input == QuietNoise ? 1e-7f : 0.1f;
+  bool silent = input == SilentTail && block > 0;
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+    data[i] = silent ? 0 : level * (2.0f * rand() / (float)RAND_MAX - 1);
+  }
+}
+
+static double nanosPerBlock(EqTopology topology, Input input, long blocks) {
+  static AudioEffectParametricEq eq;
+  eq = AudioEffectParametricEq();
+  eq.init(AUDIO_SAMPLE_RATE_EXACT);
+  eq.setTopology(topology);
+  eq.setLowGain(6);
+
+  srand(1234);
+  float data[AUDIO_BLOCK_SAMPLES];
+  float *channels[NUM_CHANNELS] = { data };
+  double nanos = 0;
+  volatile float sink = 0;
+
+  for (long b = 0; b < blocks; ++b) {
+    fill(input, data, b);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    eq.process(channels);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    nanos += std::chrono::duration<double, std::nano>(end - start).count();
+    sink = sink + data[b & (AUDIO_BLOCK_SAMPLES - 1)];
+  }
+  return nanos / blocks;
+}
+
+int main(int argc, char **argv) {
+  long blocks = argc > 1 ? atol(argv[1]) : 20000;
+  int failures = 0;
+
+  printf("%-15s %-4s %18s %12s %8s\n", "topology", "ftz", "input", "ns/block", "vs loud");
+
+  for (int ftz = 0; ftz < 2; ++ftz) {
+    if (ftz) enableFlushToZero();
+
+    for (int t = EqBiquad; t <= EqStateVariable; ++t) {
+      double loud = 0;
+      for (int in = LoudNoise; in < NUM_INPUTS; ++in) {
+        double nanos = nanosPerBlock((EqTopology)t, (Input)in, blocks);
+        if (in == LoudNoise) loud = nanos;
+
+        double ratio = nanos / loud;
+        bool slow = ratio > SLOWDOWN_LIMIT;
+        if (slow) ++failures;
+
+        printf("%-15s %-4s %18s %12.1f %7.2fx%s\n", topologyNames[t], ftz ? "on" : "off", inputNames[in],
+               nanos, ratio, slow ? "  SLOW" : "");
+      }
+    }
+  }
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,318 @@
+/*
+   Accuracy and speed of the FastMath functions, their accuracy tiers and their FastMathTable variants,
+   and of the CoefficientDesign functions.
+
+   Every function is swept over its input range and compared against libm in double. The report gives
+   the max and mean absolute and relative error, and the cost per call one value at a time through the out
+   of line function and a block at a time. Relative error leaves out the points where the reference is
+   within REL_FLOOR of zero, sin's zero crossings would drown everything else. The block versions are
+   also checked against the scalar ones bit for bit.
+
+   After the functions come the effects' call sites, each through the tier it picks and swept over the
+   inputs it sees there, so moving a call site to another tier shows up as its own accuracy change.
+
+   With -c the max errors are checked against a baseline file written by -u, and any that got worse by
+   more than BASELINE_SLACK fail the run. Timings are never checked, they are too noisy for that.
+
+   usage: fastmath_bench [-c baseline | -u baseline] [blocks]
+*/
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <Arduino.h>
+#include "../CoefficientDesign.h"
+#include "../FastMath.h"
+#include "../FastMathTables.h"
+
+#define INPUTS 64
+#define SWEEP_POINTS (1 << 20)
+#define REL_FLOOR 1e-3
+// compilers may contract or reorder the float math a little differently
+#define BASELINE_SLACK 1.01
+#define MAX_BASELINE 48
+
+// fastPow(a, b) at the exponent of the sketch's powTest()
+static float fastPowScalar(float x) {
+  return fastPow(x, 3.2f);
+}
+
+static double powReference(double x) {
+  return pow(x, 3.2);
+}
+
+static double recipReference(double x) {
+  return 1 / x;
+}
+
+static float designSin(float x) {
+  float s, c;
+  designSinCos(x, s, c);
+  return s;
+}
+
+static float designCos(float x) {
+  float s, c;
+  designSinCos(x, s, c);
+  return c;
+}
+
+static double dbToGainReference(double x) {
+  return pow(10, x / 20);
+}
+
+static double tanHalfReference(double x) {
+  return tan(x / 2);
+}
+
+// the functions without block versions of their own, a loop over the scalar one stands in
+template <float (*F)(float)>
+static void blockOf(const float *in, float *out) {
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) out[i] = F(in[i]);
+}
+
+struct MathFunction {
+  const char *name;
+  float (*scalar)(float x);
+  void (*block)(const float *in, float *out);
+  double (*reference)(double x);
+  float lo, hi;
+};
+
+static const MathFunction functions[] = {
+  { "fastTanh", fastTanh, fastTanhBlock, tanh, -3.0f, 3.0f },
+  { "fastSqrt", fastSqrt, fastSqrtBlock, sqrt, 0.0f, 2.0f },
+  { "fastRecip", fastRecip, fastRecipBlock, recipReference, 0.01f, 2.0f },
+  { "fastSin", fastSin, fastSinBlock, sin, 0.0f, TWO_PI },
+  { "fastExp", fastExp, fastExpBlock, exp, -10.0f, 10.0f },
+  { "fastLog", fastLog, fastLogBlock, log, 0.001f, 10.0f },
+  { "fastPow", fastPowScalar, blockOf<fastPowScalar>, powReference, 0.0f, 2.0f },
+  { "fastAtan", fastAtan, blockOf<fastAtan>, atan, -10.0f, 10.0f },
+  { "tanhFast", fastTanh<FastMathFast>, fastTanhBlock<FastMathFast>, tanh, -3.0f, 3.0f },
+  { "tanhMedium", fastTanh<FastMathMedium>, fastTanhBlock<FastMathMedium>, tanh, -3.0f, 3.0f },
+  { "tanhPrecise", fastTanh<FastMathPrecise>, fastTanhBlock<FastMathPrecise>, tanh, -3.0f, 3.0f },
+  { "sqrtFast", fastSqrt<FastMathFast>, fastSqrtBlock<FastMathFast>, sqrt, 0.0f, 2.0f },
+  { "sqrtMedium", fastSqrt<FastMathMedium>, fastSqrtBlock<FastMathMedium>, sqrt, 0.0f, 2.0f },
+  { "sqrtPrecise", fastSqrt<FastMathPrecise>, fastSqrtBlock<FastMathPrecise>, sqrt, 0.0f, 2.0f },
+  { "recipFast", fastRecip<FastMathFast>, fastRecipBlock<FastMathFast>, recipReference, 0.01f, 2.0f },
+  { "recipMedium", fastRecip<FastMathMedium>, fastRecipBlock<FastMathMedium>, recipReference, 0.01f, 2.0f },
+  { "recipPrecise", fastRecip<FastMathPrecise>, fastRecipBlock<FastMathPrecise>, recipReference, 0.01f, 2.0f },
+  { "logPrecise", fastLog<FastMathPrecise>, blockOf<fastLog<FastMathPrecise> >, log, 0.001f, 10.0f },
+  { "tableSin", fastSin<FastMathTable<> >, blockOf<fastSin<FastMathTable<> > >, sin, 0.0f, TWO_PI },
+  { "tableExp", fastExp<FastMathTable<> >, blockOf<fastExp<FastMathTable<> > >, exp, -10.0f, 10.0f },
+  { "tableLog", fastLog<FastMathTable<> >, blockOf<fastLog<FastMathTable<> > >, log, 0.001f, 10.0f },
+  { "designExp", designExp, blockOf<designExp>, exp, -10.0f, 10.0f },
+  { "designDb", designDbToGain, blockOf<designDbToGain>, dbToGainReference, -60.0f, 20.0f },
+  { "designSin", designSin, blockOf<designSin>, sin, -TWO_PI, TWO_PI },
+  { "designCos", designCos, blockOf<designCos>, cos, -TWO_PI, TWO_PI },
+  { "designTan", designTanHalf, blockOf<designTanHalf>, tanHalfReference, 0.0f, 3.0f },
+};
+
+#define NUM_FUNCTIONS (sizeof(functions) / sizeof(functions[0]))
+
+static const MathFunction callSites[] = {
+  // EnvelopeFollower, the mean square of EnvelopeRms and EnvelopeLogRms down to -90 dB
+  { "envRms", fastSqrt<FastMathFast>, fastSqrtBlock<FastMathFast>, sqrt, 0.0f, 1.0f },
+  { "envLogRms", fastLog, fastLogBlock, log, 1e-9f, 1.0f },
+  // AudioEffectOpticalCompressor's program dependent ratio, dB over threshold / bias
+  { "opticalRatio", fastSqrt<FastMathFast>, blockOf<fastSqrt<FastMathFast> >, sqrt, 0.0f, 1.0f },
+  // AudioEffectTubeSaturation, drive times the harmonics polynomial of +-1
+  { "tubeShaper", fastTanh<FastMathPrecise>, fastTanhBlock<FastMathPrecise>, tanh, -6.0f, 6.0f },
+  { "transformer", fastTanh<FastMathPrecise>, blockOf<fastTanh<FastMathPrecise> >, tanh, -4.0f, 4.0f },
+  // AntiderivativeTanh's fallbacks, the centroid, ln(1 + u^2 / k) and the arctangents
+  { "adaaTanh", fastTanh<FastMathPrecise>, blockOf<fastTanh<FastMathPrecise> >, tanh, -3.0f, 3.0f },
+  { "adaaLog", fastLog<FastMathPrecise>, blockOf<fastLog<FastMathPrecise> >, log, 1.0f, 200.0f },
+  { "adaaAtan", fastAtan, blockOf<fastAtan>, atan, -10.0f, 10.0f },
+};
+
+#define NUM_CALL_SITES (sizeof(callSites) / sizeof(callSites[0]))
+
+struct Errors {
+  double maxAbs, meanAbs;
+  double maxRel, meanRel;
+  bool blockMatches;
+};
+
+struct Baseline {
+  char name[32];
+  double maxAbs, maxRel;
+};
+
+static float input[INPUTS][AUDIO_BLOCK_SAMPLES];
+static float output[AUDIO_BLOCK_SAMPLES];
+
+static double nanosSince(std::chrono::steady_clock::time_point start, long samples) {
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / samples;
+}
+
+// SWEEP_POINTS evenly spaced from lo to hi, both ends included, a block at a time
+static void sweep(const MathFunction &fn, Errors &errors) {
+  float in[AUDIO_BLOCK_SAMPLES];
+  double sumAbs = 0, sumRel = 0;
+  long relPoints = 0;
+
+  memset(&errors, 0, sizeof(errors));
+  errors.blockMatches = true;
+
+  for (long p = 0; p < SWEEP_POINTS; p += AUDIO_BLOCK_SAMPLES) {
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      in[i] = fn.lo + (fn.hi - fn.lo) * (double)(p + i) / (SWEEP_POINTS - 1);
+    }
+    fn.block(in, output);
+
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      float y = fn.scalar(in[i]);
+      if (memcmp(&y, &output[i], sizeof(y)) != 0) errors.blockMatches = false;
+
+      double ref = fn.reference(in[i]);
+      double absError = fabs(y - ref);
+      errors.maxAbs = max(errors.maxAbs, absError);
+      sumAbs += absError;
+      if (fabs(ref) >= REL_FLOOR) {
+        double rel = absError / fabs(ref);
+        errors.maxRel = max(errors.maxRel, rel);
+        sumRel += rel;
+        ++relPoints;
+      }
+    }
+  }
+
+  errors.meanAbs = sumAbs / SWEEP_POINTS;
+  errors.meanRel = relPoints ? sumRel / relPoints : 0;
+}
+
+static void measureSpeed(const MathFunction &fn, long blocks, double &scalarNanos, double &blockNanos) {
+  long samples = blocks * AUDIO_BLOCK_SAMPLES;
+
+  srand(1234);
+  for (int b = 0; b < INPUTS; ++b) {
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      input[b][i] = fn.lo + (fn.hi - fn.lo) * rand() / (float)RAND_MAX;
+    }
+  }
+
+  // the scalar pass has to go through the out of line function, like the effects do
+  volatile float sink = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long b = 0; b < blocks; ++b) {
+    const float *in = input[b & (INPUTS - 1)];
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) output[i] = fn.scalar(in[i]);
+    sink = sink + output[b & (AUDIO_BLOCK_SAMPLES - 1)];
+  }
+  scalarNanos = nanosSince(start, samples);
+
+  start = std::chrono::steady_clock::now();
+  for (long b = 0; b < blocks; ++b) {
+    fn.block(input[b & (INPUTS - 1)], output);
+    sink = sink + output[b & (AUDIO_BLOCK_SAMPLES - 1)];
+  }
+  blockNanos = nanosSince(start, samples);
+}
+
+// the entries read, or -1 if the file can't be opened
+static int readBaseline(const char *path, Baseline *baseline) {
+  FILE *file = fopen(path, "r");
+  if (!file) return -1;
+
+  int count = 0;
+  char line[128];
+  while (count < MAX_BASELINE && fgets(line, sizeof(line), file)) {
+    Baseline &b = baseline[count];
+    if (line[0] == '#') continue;
+    if (sscanf(line, "%31s %lf %lf", b.name, &b.maxAbs, &b.maxRel) == 3) ++count;
+  }
+  fclose(file);
+  return count;
+}
+
+static const Baseline *findBaseline(const Baseline *baseline, int count, const char *name) {
+  for (int b = 0; b < count; ++b) {
+    if (strcmp(baseline[b].name, name) == 0) return &baseline[b];
+  }
+  return NULL;
+}
+
+// sweep, time and report fn, written to update and checked against the baseline when given, the checks failed
+static int measure(const MathFunction &fn, long blocks, FILE *update, const char *checkPath,
+                   const Baseline *baseline, int baselineCount) {
+  int failures = 0;
+
+  Errors errors;
+  sweep(fn, errors);
+  double scalarNanos, blockNanos;
+  measureSpeed(fn, blocks, scalarNanos, blockNanos);
+
+  printf("%-12s %10.3e %10.3e %10.3e %10.3e %10.3f %10.3f\n", fn.name, errors.maxAbs, errors.meanAbs,
+         errors.maxRel, errors.meanRel, scalarNanos, blockNanos);
+
+  if (!errors.blockMatches) {
+    printf("%s: block result differs from scalar\n", fn.name);
+    ++failures;
+  }
+
+  if (update) fprintf(update, "%s %.3e %.3e\n", fn.name, errors.maxAbs, errors.maxRel);
+
+  if (checkPath) {
+    const Baseline *b = findBaseline(baseline, baselineCount, fn.name);
+    if (!b) {
+      printf("%s: not in %s\n", fn.name, checkPath);
+      ++failures;
+    } else if (errors.maxAbs > b->maxAbs * BASELINE_SLACK || errors.maxRel > b->maxRel * BASELINE_SLACK) {
+      printf("%s: worse than the baseline, max abs %.3e, max rel %.3e\n", fn.name, b->maxAbs, b->maxRel);
+      ++failures;
+    }
+  }
+
+  return failures;
+}
+
+int main(int argc, char **argv) {
+  const char *checkPath = NULL, *updatePath = NULL;
+  long blocks = 200000;
+  for (int a = 1; a < argc; ++a) {
+    if (strcmp(argv[a], "-c") == 0 && a + 1 < argc) checkPath = argv[++a];
+    else if (strcmp(argv[a], "-u") == 0 && a + 1 < argc) updatePath = argv[++a];
+    else blocks = atol(argv[a]);
+  }
+
+  Baseline baseline[MAX_BASELINE];
+  int baselineCount = 0;
+  if (checkPath) {
+    baselineCount = readBaseline(checkPath, baseline);
+    if (baselineCount < 0) {
+      printf("can't read %s\n", checkPath);
+      return 1;
+    }
+  }
+
+  FILE *update = NULL;
+  if (updatePath) {
+    update = fopen(updatePath, "w");
+    if (!update) {
+      printf("can't write %s\n", updatePath);
+      return 1;
+    }
+    fprintf(update, "# function, max absolute and max relative error, written by fastmath_bench -u\n");
+  }
+
+  int failures = 0;
+
+  printf("%-12s %10s %10s %10s %10s %10s %10s\n", "function", "max abs", "mean abs", "max rel", "mean rel",
+         "scalar ns", "block ns");
+  for (size_t f = 0; f < NUM_FUNCTIONS; ++f) {
+    failures += measure(functions[f], blocks, update, checkPath, baseline, baselineCount);
+  }
+
+  printf("\n%-12s %10s %10s %10s %10s %10s %10s\n", "call site", "max abs", "mean abs", "max rel", "mean rel",
+         "scalar ns", "block ns");
+  for (size_t f = 0; f < NUM_CALL_SITES; ++f) {
+    failures += measure(callSites[f], blocks, update, checkPath, baseline, baselineCount);
+  }
+
+  if (update) fclose(update);
+
+  return failures ? 1 : 0;
+}
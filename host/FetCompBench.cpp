@@ -0,0 +1,158 @@
+/*
+   FET compressor gain computer run per sample vs at a decimated control rate.
+
+   The same test signal goes through one compressor per control rate. The per-sample compressor is the
+   reference. For every rate the report gives the cost per block, the worst and RMS difference of the
+   applied gain in dB, and the difference signal relative to the reference output.
+
+   The signal steps through quiet, moderate and hot passages of tone bursts and noise, so the gain
+   computer sees attack, release and ratio changes. Both the default (fast) and a slow release setting
+   are run.
+
+   The lookahead delay line is checked against a brute force window peak at short, medium and the longest
+   length, on the same signal and on a falling ramp, which keeps every sample in the peak deque at once.
+   Fails if any sample of the delayed output or the peak differs.
+
+   usage: fetcomp_bench [blocks]
+*/
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Arduino.h>
+#include "../AudioEffectFetCompressor.h"
+#include "../LookaheadDelay.h"
+#include "BenchSignal.h"
+
+// gain is only compared where the input is above this, near zero crossings y / x says nothing
+#define GAIN_FLOOR 0.001f
+
+struct Setting {
+  const char *name;
+  float attackUs;
+  float releaseMs;
+};
+
+static const Setting settings[] = {
+  { "20us / 50ms", 20, 50 },
+  { "800us / 500ms", 800, 500 },
+};
+
+static const int rates[] = { 1, 2, 4, 8, 16 };
+
+static const int lookaheadLengths[] = { 1, 64, LOOKAHEAD_SIZE - 1 };
+
+// samples the lookahead check runs over, the brute force peak costs the window length per sample
+#define LOOKAHEAD_CHECK_BLOCKS 64
+
+#define NUM_SETTINGS (sizeof(settings) / sizeof(settings[0]))
+#define NUM_RATES (sizeof(rates) / sizeof(rates[0]))
+#define NUM_LOOKAHEADS (sizeof(lookaheadLengths) / sizeof(lookaheadLengths[0]))
+
+static double run(const Setting &setting, int rate, const float *in, float *out, long blocks) {
+  static AudioEffectFetCompressor comp;
+  comp = AudioEffectFetCompressor();
+  comp.init(AUDIO_SAMPLE_RATE_EXACT);
+  comp.setAttackTimeUs(setting.attackUs);
+  comp.setReleaseTimeMs(setting.releaseMs);
+  comp.setControlRate(rate);
+
+  double nanos = 0;
+  for (long b = 0; b < blocks; ++b) {
+    float *data = out + b * AUDIO_BLOCK_SAMPLES;
+    float *channels[NUM_CHANNELS] = { data };
+    memcpy(data, in + b * AUDIO_BLOCK_SAMPLES, AUDIO_BLOCK_SAMPLES * sizeof(float));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    comp.process(channels);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    nanos += std::chrono::duration<double, std::nano>(end - start).count();
+  }
+  return nanos / blocks;
+}
+
+// LookaheadDelay against the input delayed by length and the peak of the length + 1 samples leaving next,
+// the number of samples where either differs
+static long checkLookahead(int length, const float *in, long blocks) {
+  static LookaheadDelay lookahead;
+  lookahead.setLength(length);
+
+  long wrong = 0;
+  for (long b = 0; b < blocks; ++b) {
+    float data[AUDIO_BLOCK_SAMPLES], peak[AUDIO_BLOCK_SAMPLES];
+    memcpy(data, in + b * AUDIO_BLOCK_SAMPLES, sizeof(data));
+    lookahead.process(data, peak);
+
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+      long n = b * AUDIO_BLOCK_SAMPLES + i;
+      float delayed = n >= length ? in[n - length] : 0;
+      float windowPeak = 0;
+      for (long k = max(0L, n - length); k <= n; ++k) windowPeak = max(windowPeak, fabsf(in[k]));
+      wrong += data[i] != delayed || peak[i] != windowPeak;
+    }
+  }
+  return wrong;
+}
+
+int main(int argc, char **argv) {
+  long blocks = argc > 1 ? atol(argv[1]) : 4000;
+  long samples = blocks * AUDIO_BLOCK_SAMPLES;
+
+  float *in = new float[samples];
+  float *reference = new float[samples];
+  float *out = new float[samples];
+  makeLevelSteps(in, samples, AUDIO_SAMPLE_RATE_EXACT);
+
+  for (size_t s = 0; s < NUM_SETTINGS; ++s) {
+    printf("attack / release %s\n", settings[s].name);
+    printf("%6s %12s %8s %14s %14s %14s\n", "rate", "ns/block", "speedup", "max gain dB", "rms gain dB", "error dB");
+
+    double referenceNanos = run(settings[s], 1, in, reference, blocks);
+
+    for (size_t r = 0; r < NUM_RATES; ++r) {
+      double nanos = rates[r] == 1 ? referenceNanos : run(settings[s], rates[r], in, out, blocks);
+      if (rates[r] == 1) memcpy(out, reference, samples * sizeof(float));
+
+      double maxGainDb = 0, sumGainDb = 0, sumError = 0, sumSignal = 0;
+      long compared = 0;
+      for (long i = 0; i < samples; ++i) {
+        double error = out[i] - reference[i];
+        sumError += error * error;
+        sumSignal += (double)reference[i] * reference[i];
+
+        if (fabsf(in[i]) < GAIN_FLOOR) continue;
+        double gainDb = 20 * log10(fabs(out[i] / in[i])) - 20 * log10(fabs(reference[i] / in[i]));
+        maxGainDb = fmax(maxGainDb, fabs(gainDb));
+        sumGainDb += gainDb * gainDb;
+        ++compared;
+      }
+
+      double rmsGainDb = compared ? sqrt(sumGainDb / compared) : 0;
+      double errorDb = sumError > 0 ? 10 * log10(sumError / sumSignal) : -INFINITY;
+      printf("%6d %12.1f %7.2fx %14.4f %14.4f %14.1f\n", rates[r], nanos, referenceNanos / nanos, maxGainDb,
+             rmsGainDb, errorDb);
+    }
+    printf("\n");
+  }
+
+  long lookaheadSamples = LOOKAHEAD_CHECK_BLOCKS * AUDIO_BLOCK_SAMPLES;
+  float *ramp = new float[lookaheadSamples];
+  for (long i = 0; i < lookaheadSamples; ++i) ramp[i] = 1.0f - (float)i / lookaheadSamples;
+
+  int failures = 0;
+  printf("%10s %14s %14s\n", "lookahead", "steps wrong", "ramp wrong");
+  for (size_t l = 0; l < NUM_LOOKAHEADS; ++l) {
+    long steps = checkLookahead(lookaheadLengths[l], in, min(blocks, (long)LOOKAHEAD_CHECK_BLOCKS));
+    long falling = checkLookahead(lookaheadLengths[l], ramp, LOOKAHEAD_CHECK_BLOCKS);
+    printf("%10d %14ld %14ld%s\n", lookaheadLengths[l], steps, falling, steps || falling ? "  WRONG" : "");
+    failures += steps || falling;
+  }
+
+  delete[] in;
+  delete[] reference;
+  delete[] out;
+  delete[] ramp;
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,160 @@
+/*
+   The FIXED_POINT_DSP paths against the float ones: SNR and cost per block of the parametric EQ and the
+   FET and optical compressors.
+
+   Each setup runs two instances on the same int16 input, one through processFixed() and one through
+   process() on the input converted to float. The float output, clipped to the int16 range like
+   convertToInt() does but not rounded, is the reference. The SNR is its power over the power of the fixed
+   point output's difference from it, so the rounding to 16 bits is part of the error, about 98 dB on a
+   full scale sine. The float path has rounding of its own: its transposed direct form II state loses more
+   than the fixed point direct form I with error feedback, which makes up most of the EQ's difference.
+
+   The signal steps through quiet, moderate and hot passages of tone bursts and noise, so the compressors
+   attack, release and sit at different gains. Fails if any SNR is below MIN_SNR_DB.
+
+   This program is always built with FIXED_POINT_DSP=1, whatever the rest of the host build uses.
+
+   usage: fixedpoint_bench [blocks]
+*/
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <Arduino.h>
+#include "../AudioEffectFetCompressor.h"
+#include "../AudioEffectOpticalCompressor.h"
+#include "../AudioEffectParametricEq.h"
+#include "BenchSignal.h"
+
+#if !FIXED_POINT_DSP
+#error "fixedpoint_bench needs FIXED_POINT_DSP=1"
+#endif
+
+#define MIN_SNR_DB 70.0
+
+struct Result {
+  double fixedNanos, floatNanos;
+  double snrDb;
+};
+
+static double nanosSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+// EFFECT has been set up the same way twice, fixedEffect runs processFixed() and floatEffect process()
+template <class EFFECT>
+static void run(EFFECT &fixedEffect, EFFECT &floatEffect, const int16_t *in, long blocks, Result &result) {
+  double signal = 0, noise = 0;
+  result.fixedNanos = result.floatNanos = 0;
+
+  for (long b = 0; b < blocks; ++b) {
+    int16_t fixedData[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+    float floatData[NUM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+    int16_t *fixedChannels[NUM_CHANNELS];
+    float *floatChannels[NUM_CHANNELS];
+
+    for (int c = 0; c < NUM_CHANNELS; ++c) {
+      fixedChannels[c] = fixedData[c];
+      floatChannels[c] = floatData[c];
+      memcpy(fixedData[c], in + b * AUDIO_BLOCK_SAMPLES, sizeof(fixedData[c]));
+      AudioStreamFloat::convertToFloat(fixedData[c], floatData[c]);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    fixedEffect.processFixed(fixedChannels);
+    result.fixedNanos += nanosSince(start);
+
+    start = std::chrono::steady_clock::now();
+    floatEffect.process(floatChannels);
+    result.floatNanos += nanosSince(start);
+
+    for (int c = 0; c < NUM_CHANNELS; ++c) {
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+        double reference = min(max(floatData[c][i] * FLOAT_TO_INT, -32768.0f), 32767.0f);
+        double error = fixedData[c][i] - reference;
+        signal += reference * reference;
+        noise += error * error;
+      }
+    }
+  }
+
+  result.fixedNanos /= blocks;
+  result.floatNanos /= blocks;
+  result.snrDb = 10 * log10(signal / (noise + 1e-30));
+}
+
+static const int rates[] = { 1, 16 };
+
+#define NUM_RATES (sizeof(rates) / sizeof(rates[0]))
+
+// one pair of instances per setup, every AudioStream stays on the update list for good
+static AudioEffectParametricEq fixedEq, floatEq;
+static AudioEffectFetCompressor fixedFet[NUM_RATES], floatFet[NUM_RATES];
+static AudioEffectOpticalCompressor fixedOptical, floatOptical;
+
+static void setupEq(AudioEffectParametricEq &eq) {
+  eq.init(AUDIO_SAMPLE_RATE_EXACT);
+  eq.setLowGain(6);
+}
+
+static void setupFet(AudioEffectFetCompressor &comp, int controlRate) {
+  comp.init(AUDIO_SAMPLE_RATE_EXACT);
+  comp.setThresholdDb(-20);
+  comp.setGainDb(6);
+  comp.setMix(80);
+  comp.setControlRate(controlRate);
+}
+
+static void setupOptical(AudioEffectOpticalCompressor &comp) {
+  comp.init(AUDIO_SAMPLE_RATE_EXACT);
+  comp.setThresholdDb(-20);
+  comp.setMakeupGainDb(6);
+}
+
+static int report(const char *name, const Result &result) {
+  bool low = result.snrDb < MIN_SNR_DB;
+  printf("%-22s %10.1f %10.1f %10.1f%s\n", name, result.snrDb, result.fixedNanos, result.floatNanos,
+         low ? "  LOW" : "");
+  return low ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+  long blocks = argc > 1 ? atol(argv[1]) : 4000;
+  int failures = 0;
+
+  // every channel the same
+  std::vector<float> signal(blocks * AUDIO_BLOCK_SAMPLES);
+  makeLevelSteps(signal.data(), signal.size(), AUDIO_SAMPLE_RATE_EXACT);
+  std::vector<int16_t> input(signal.size());
+  for (size_t i = 0; i < input.size(); ++i) input[i] = (int16_t)(signal[i] * 32767);
+
+  printf("%-22s %10s %10s %10s\n", "effect", "SNR dB", "fixed ns", "float ns");
+
+  Result result;
+
+  setupEq(fixedEq);
+  setupEq(floatEq);
+  run(fixedEq, floatEq, input.data(), blocks, result);
+  failures += report("parametric EQ", result);
+
+  for (size_t r = 0; r < NUM_RATES; ++r) {
+    char name[32];
+    snprintf(name, sizeof(name), "FET, control rate %d", rates[r]);
+    setupFet(fixedFet[r], rates[r]);
+    setupFet(floatFet[r], rates[r]);
+    run(fixedFet[r], floatFet[r], input.data(), blocks, result);
+    failures += report(name, result);
+  }
+
+  setupOptical(fixedOptical);
+  setupOptical(floatOptical);
+  run(fixedOptical, floatOptical, input.data(), blocks, result);
+  failures += report("optical", result);
+
+  return failures ? 1 : 0;
+}
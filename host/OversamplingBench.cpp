@@ -0,0 +1,212 @@
+/*
+   Tube saturation aliasing and cost, the old interpolating oversampler against the half-band filters,
+   antiderivative antialiasing and the transfer curve table.
+
+   The old path drew a straight line from the previous input to the current one, ran the shaper at
+   OVERSAMPLING points along it and averaged them, it is reimplemented here. The others are
+   AudioEffectTubeSaturation itself with its low pass opened up, so nothing else hides the aliases, with
+   the formula or with the transfer curve table.
+
+   A sine that fits a whole number of times into the FFT is driven through each one. Everything the
+   shaper makes lands on harmonics of it, and whatever lands anywhere else folded back from above Nyquist.
+   The report gives that aliased power and the level of the fundamental, both relative to the fundamental
+   of the input, and the cost per block.
+
+   usage: oversampling_bench [blocks]
+*/
+
+#include <chrono>
+#include <complex>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <Arduino.h>
+#include "../AudioEffectTubeSaturation.h"
+#include "../FastMath.h"
+
+#define FFT_SIZE 4096
+#define AMPLITUDE 0.5f
+#define DRIVE 1.0f
+// blocks run before the analysed ones, past the filters' start up
+#define SETTLE_BLOCKS 4
+
+// cycles per FFT_SIZE, odd so no harmonic or alias lands on another harmonic, about 1kHz and 5kHz at 44.1kHz
+static const int tones[] = { 93, 467 };
+
+#define NUM_TONES (sizeof(tones) / sizeof(tones[0]))
+
+// same transfer function as AudioEffectTubeSaturation::addEvenOrderHarmonics()
+static float evenHarmonics(float x) {
+  float x2 = x * x;
+  return x + 2 * 0.5f * x * (1 + 2 * x2 * (3 * x2 - 1));
+}
+
+class Shaper {
+  public:
+    virtual ~Shaper() {}
+    virtual void process(float *data) = 0;
+};
+
+// the saturation() the effect used before HalfBandOversampler, any of its OVERSAMPLING settings
+class LegacyShaper : public Shaper {
+  public:
+    LegacyShaper(int factor) : factor(factor) {}
+
+    void process(float *data) {
+      float step = 1.0f / factor;
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i) {
+        float y2 = data[i];
+        float m = (y2 - last) * step;
+        float w = last;
+        float sum = 0;
+        for (int s = 1; s < factor; ++s) {
+          w += m;
+          sum += fastTanh(DRIVE * evenHarmonics(w));
+        }
+        sum += fastTanh(DRIVE * evenHarmonics(y2));
+        last = y2;
+        data[i] = sum * step;
+      }
+    }
+
+  private:
+    int factor;
+    float last = 0;
+};
+
+class EffectShaper : public Shaper {
+  public:
+    EffectShaper(int factor, int order, TubeShaper tubeShaper) {
+      effect.init(AUDIO_SAMPLE_RATE_EXACT);
+      effect.setDrive(DRIVE);
+      effect.setMakeupGainDb(0);
+      effect.setLpfFrequency(1e9);
+      effect.setOversampling(factor);
+      effect.setAntiderivativeOrder(order);
+      effect.setShaper(tubeShaper);
+    }
+
+    void process(float *data) {
+      float *channels[NUM_CHANNELS] = { data };
+      effect.process(channels);
+    }
+
+  private:
+    AudioEffectTubeSaturation effect;
+};
+
+struct Config {
+  const char *name;
+  bool legacy;
+  int factor;
+  int order;
+  TubeShaper shaper;
+};
+
+static const Config configs[] = {
+  { "legacy 1x", true, 1, 0, TubeFormula },
+  { "legacy 2x", true, 2, 0, TubeFormula },
+  { "legacy 4x", true, 4, 0, TubeFormula },
+  { "legacy 8x", true, 8, 0, TubeFormula },
+  { "half-band 2x", false, 2, 0, TubeFormula },
+  { "half-band 4x", false, 4, 0, TubeFormula },
+  { "half-band 8x", false, 8, 0, TubeFormula },
+  { "ADAA1 1x", false, 1, 1, TubeFormula },
+  { "ADAA2 1x", false, 1, 2, TubeFormula },
+  { "ADAA1 2x", false, 2, 1, TubeFormula },
+  { "linear LUT 2x", false, 2, 0, TubeTableLinear },
+  { "cubic LUT 2x", false, 2, 0, TubeTableCubic },
+};
+
+#define NUM_CONFIGS (sizeof(configs) / sizeof(configs[0]))
+
+static void fft(std::vector<std::complex<double> > &x) {
+  size_t n = x.size();
+  for (size_t i = 1, j = 0; i < n; ++i) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) std::swap(x[i], x[j]);
+  }
+  for (size_t len = 2; len <= n; len <<= 1) {
+    std::complex<double> w = std::polar(1.0, -2 * M_PI / len);
+    for (size_t i = 0; i < n; i += len) {
+      std::complex<double> wk = 1;
+      for (size_t k = 0; k < len / 2; ++k) {
+        std::complex<double> a = x[i + k], b = x[i + k + len / 2] * wk;
+        x[i + k] = a + b;
+        x[i + k + len / 2] = a - b;
+        wk *= w;
+      }
+    }
+  }
+}
+
+// power of the aliases and of the fundamental, in dB relative to the input tone
+static void analyse(const float *out, int tone, double &aliasDb, double &fundamentalDb) {
+  std::vector<std::complex<double> > x(out, out + FFT_SIZE);
+  fft(x);
+
+  double fundamental = 0, alias = 0;
+  for (int k = 1; k < FFT_SIZE / 2; ++k) {
+    double power = std::norm(x[k]);
+    if (k == tone) fundamental = power;
+    else if (k % tone != 0) alias += power;
+  }
+
+  double reference = (double)AMPLITUDE * AMPLITUDE * FFT_SIZE * FFT_SIZE / 4;
+  aliasDb = 10 * log10(alias / reference + 1e-30);
+  fundamentalDb = 10 * log10(fundamental / reference);
+}
+
+static void run(const Config &config, int tone, long blocks, double &nanos, double &aliasDb, double &fundamentalDb) {
+  Shaper *shaper = config.legacy ? (Shaper *)new LegacyShaper(config.factor) :
+                   new EffectShaper(config.factor, config.order, config.shaper);
+
+  const int analysed = FFT_SIZE / AUDIO_BLOCK_SAMPLES;
+  std::vector<float> out(FFT_SIZE);
+  float data[AUDIO_BLOCK_SAMPLES];
+
+  long total = max(blocks, (long)(SETTLE_BLOCKS + analysed));
+  long pos = 0;
+  nanos = 0;
+  for (long b = 0; b < total; ++b) {
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; ++i, ++pos) {
+      data[i] = AMPLITUDE * sin(2 * M_PI * tone * (pos % FFT_SIZE) / FFT_SIZE);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    shaper->process(data);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    nanos += std::chrono::duration<double, std::nano>(end - start).count();
+
+    long a = b - SETTLE_BLOCKS;
+    if (a >= 0 && a < analysed) memcpy(&out[a * AUDIO_BLOCK_SAMPLES], data, sizeof(data));
+  }
+  nanos /= total;
+
+  analyse(out.data(), tone, aliasDb, fundamentalDb);
+  delete shaper;
+}
+
+int main(int argc, char **argv) {
+  long blocks = argc > 1 ? atol(argv[1]) : 4000;
+
+  for (size_t t = 0; t < NUM_TONES; ++t) {
+    printf("tone %.0f Hz at 44.1kHz, %.1f dBFS, drive %.1f\n", tones[t] * 44100.0 / FFT_SIZE,
+           20 * log10(AMPLITUDE), DRIVE);
+    printf("%-14s %12s %12s %14s\n", "oversampling", "ns/block", "alias dBc", "fundamental dB");
+
+    for (size_t c = 0; c < NUM_CONFIGS; ++c) {
+      double nanos, aliasDb, fundamentalDb;
+      run(configs[c], tones[t], blocks, nanos, aliasDb, fundamentalDb);
+      printf("%-14s %12.1f %12.1f %14.2f\n", configs[c].name, nanos, aliasDb, fundamentalDb);
+    }
+    printf("\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,236 @@
+/*
+   Offline renderer for the TeensyEffect patch.
+
+   Builds the same objects and patch cords as TeensyEffect.ino, feeds a WAV file through them block by block
+   and reports throughput plus the per-stage cost relative to one block period at the file's sample rate.
+
+   By default the effects are patched with float connections, converting once at each end, like the sketch.
+   -i patches them with int16 connections instead, converting in and out of every effect.
+   -f runs them fused in a single AudioEffectPreampChain object, behind the same denoiser.
+
+   usage: teensy_render [-i | -f] <in.wav> [out.wav]
+*/
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "AudioHostIo.h"
+#include "WavFile.h"
+
+#include "../AudioConvertFloat.h"
+#include "../AudioFilterDenoiser.h"
+#include "../AudioEffectTubeSaturation.h"
+#include "../AudioEffectParametricEq.h"
+#include "../AudioEffectOpticalCompressor.h"
+#include "../AudioEffectFetCompressor.h"
+#include "../AudioEffectExciter.h"
+#include "../AudioEffectOutputTransformer.h"
+#include "../AudioEffectPreampChain.h"
+#include "../FastMath.h"
+
+// same construction order as the sketch, which is also the update order
+// AudioFilterShelfEq and AudioEffectDbx160Comp are not part of this tree, their cords are bridged
+AudioHostInput      audioInput;
+AudioHostOutput     audioOutput;
+
+AudioConvertIntToFloat toFloat;
+AudioFilterDenoiser denoiser;
+AudioEffectTubeSaturation tubeSat;
+AudioEffectOpticalCompressor optComp;
+AudioEffectParametricEq paraEq;
+AudioEffectFetCompressor fetComp;
+AudioEffectExciter exciter;
+AudioEffectOutputTransformer outTrans;
+AudioConvertFloatToInt toInt;
+
+AudioEffectPreampChain preamp;
+
+enum Patch {
+  FloatPatch, IntPatch, FusedPatch
+};
+
+static void patchFloat(void) {
+  new AudioConnection(audioInput, toFloat);
+  new AudioConnectionFloat(toFloat, denoiser);
+  new AudioConnectionFloat(denoiser, tubeSat);
+  new AudioConnectionFloat(tubeSat, optComp);
+  new AudioConnectionFloat(optComp, paraEq);
+  new AudioConnectionFloat(paraEq, fetComp);
+  new AudioConnectionFloat(fetComp, outTrans);
+  new AudioConnectionFloat(outTrans, toInt);
+  new AudioConnection(toInt, 0, audioOutput, 0);
+}
+
+static void patchInt(void) {
+  new AudioConnection(audioInput, denoiser);
+  new AudioConnection(denoiser, tubeSat);
+  new AudioConnection(tubeSat, optComp);
+  new AudioConnection(optComp, paraEq);
+  new AudioConnection(paraEq, fetComp);
+  new AudioConnection(fetComp, outTrans);
+  new AudioConnection(outTrans, 0, audioOutput, 0);
+}
+
+struct Stage {
+  const char *name;
+  AudioStream *stream;
+  void (*getProfile)(EffectProfile &profile);
+};
+
+static const Stage stages[] = {
+  { "Denoiser", &denoiser, [](EffectProfile & p) { denoiser.getProfile(p); } },
+  { "TubeSaturation", &tubeSat, [](EffectProfile & p) { tubeSat.getProfile(p); } },
+  { "OpticalCompressor", &optComp, [](EffectProfile & p) { optComp.getProfile(p); } },
+  { "ParametricEq", &paraEq, [](EffectProfile & p) { paraEq.getProfile(p); } },
+  { "FetCompressor", &fetComp, [](EffectProfile & p) { fetComp.getProfile(p); } },
+  { "OutputTransformer", &outTrans, [](EffectProfile & p) { outTrans.getProfile(p); } },
+  { "PreampChain", &preamp, [](EffectProfile & p) { preamp.getProfile(p); } },
+};
+
+#define NUM_STAGES (sizeof(stages) / sizeof(stages[0]))
+
+struct Dynamics {
+  const char *name;
+  void (*getLevels)(DynamicsLevels &levels);
+};
+
+// the fused chain's compressors meter themselves too
+static const Dynamics dynamics[] = {
+  { "Denoiser", [](DynamicsLevels & l) { denoiser.getLevels(l); } },
+  { "OpticalCompressor", [](DynamicsLevels & l) { optComp.getLevels(l); } },
+  { "FetCompressor", [](DynamicsLevels & l) { fetComp.getLevels(l); } },
+  { "PreampChain optical", [](DynamicsLevels & l) { preamp.getOpticalCompressor().getLevels(l); } },
+  { "PreampChain FET", [](DynamicsLevels & l) { preamp.getFetCompressor().getLevels(l); } },
+};
+
+#define NUM_DYNAMICS (sizeof(dynamics) / sizeof(dynamics[0]))
+
+// the denoiser passes float blocks to the chain like it does in the float patch, so both come out the same
+static void patchFused(void) {
+  new AudioConnection(audioInput, toFloat);
+  new AudioConnectionFloat(toFloat, denoiser);
+  new AudioConnectionFloat(denoiser, preamp);
+  new AudioConnectionFloat(preamp, toInt);
+  new AudioConnection(toInt, 0, audioOutput, 0);
+}
+
+static void setup(float sampleRate, Patch patch) {
+  AudioStream::setSampleRate(sampleRate);
+
+  switch (patch) {
+    case FloatPatch:
+      patchFloat();
+      break;
+    case IntPatch:
+      patchInt();
+      break;
+    case FusedPatch:
+      patchFused();
+      break;
+  }
+
+  denoiser.init(sampleRate);
+  tubeSat.init(sampleRate);
+  paraEq.init(sampleRate);
+  optComp.init(sampleRate);
+  fetComp.init(sampleRate);
+  exciter.init(sampleRate);
+  preamp.init(sampleRate);
+
+  AudioMemory(32);
+  AudioMemoryFloat(16);
+
+  // the sketch learns the noise floor from the first second
+  denoiser.captureNoise(1.0);
+}
+
+int main(int argc, char **argv) {
+  Patch patch = FloatPatch;
+  if (argc > 1 && (strcmp(argv[1], "-i") == 0 || strcmp(argv[1], "-f") == 0)) {
+    patch = argv[1][1] == 'i' ? IntPatch : FusedPatch;
+    --argc;
+    ++argv;
+  }
+
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: teensy_render [-i | -f] <in.wav> [out.wav]\n");
+    return 2;
+  }
+
+  std::vector<int16_t> input;
+  float sampleRate;
+  if (!readWav(argv[1], input, sampleRate)) return 1;
+
+  setup(sampleRate, patch);
+  audioInput.setSource(input.data(), input.size());
+
+  // oversampling and lookahead delay inside the effects, on top of the block latency of the patch
+  int effectLatency = denoiser.getLatency() + (patch == FusedPatch ? preamp.getLatency() :
+                      tubeSat.getLatency() + optComp.getLatency() + fetComp.getLatency() + outTrans.getLatency());
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  // run until the whole file has come out the other end, then drop the patch latency
+  size_t blocks = 0;
+  while (!audioInput.isFinished() ||
+         audioOutput.getSamples().size() <
+         input.size() + audioOutput.latencyBlocks() * AUDIO_BLOCK_SAMPLES + effectLatency) {
+    AudioStream::update_all();
+    ++blocks;
+  }
+
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+
+  std::vector<int16_t> &output = audioOutput.getSamples();
+  output.erase(output.begin(), output.begin() + effectLatency);
+  output.resize(input.size());
+
+  double audioSeconds = blocks * AUDIO_BLOCK_SAMPLES / sampleRate;
+  double blockMicros = AUDIO_BLOCK_SAMPLES * 1.0e6 / sampleRate;
+
+  printf("rendered %zu samples (%zu blocks) at %.0f Hz in %.3f s\n", input.size(), blocks, sampleRate, seconds);
+  printf("throughput %.0f samples/s, %.1fx realtime, patch latency %d blocks + %d samples in the effects\n",
+         blocks * AUDIO_BLOCK_SAMPLES / seconds, audioSeconds / seconds, audioOutput.latencyBlocks(), effectLatency);
+  printf("\n%-20s %10s %8s %8s\n", "stage", "us/block", "cpu %", "max %");
+
+  double totalMicros = 0;
+  for (size_t i = 0; i < NUM_STAGES; ++i) {
+    AudioStream *s = stages[i].stream;
+    if (s->updateCount() == 0) continue;
+    double micros = s->processorNanosTotal() * 1.0e-3 / max(s->updateCount(), 1u);
+    totalMicros += micros;
+    printf("%-20s %10.3f %8.3f %8.3f\n", stages[i].name, micros, 100.0 * micros / blockMicros, s->processorUsageMax());
+  }
+  printf("%-20s %10.3f %8.3f\n", "total", totalMicros, 100.0 * totalMicros / blockMicros);
+  printf("audio memory used max %d int16 blocks, %d float blocks\n",
+         AudioStream::memory_used_max, AudioStreamFloat::memory_used_float_max);
+
+  printf("\n%-20s %8s %8s %8s %8s  (us, last %d blocks)\n", "stage", "min", "mean", "p99", "max", PROFILER_HISTORY);
+  for (size_t i = 0; i < NUM_STAGES; ++i) {
+    EffectProfile profile;
+    stages[i].getProfile(profile);
+    if (profile.blocks == 0) continue;
+    printf("%-20s %8.3f %8.3f %8.3f %8.3f\n", stages[i].name,
+           EffectProfiler::ticksToMicros(profile.minTicks), EffectProfiler::ticksToMicros(profile.meanTicks),
+           EffectProfiler::ticksToMicros(profile.p99Ticks), EffectProfiler::ticksToMicros(profile.maxTicks));
+  }
+
+  printf("\n%-20s %15s %15s %15s  (dB, last block, channel 0)\n", "dynamics", "in peak/rms", "out peak/rms",
+         "gr max/mean");
+  for (size_t i = 0; i < NUM_DYNAMICS; ++i) {
+    DynamicsLevels levels;
+    dynamics[i].getLevels(levels);
+    if (levels.blocks == 0) continue;
+    printf("%-20s %7.1f %7.1f %7.1f %7.1f %7.1f %7.1f\n", dynamics[i].name,
+           DynamicsMeter::toDb(levels.peakIn[0]), DynamicsMeter::toDb(levels.rmsIn[0]),
+           DynamicsMeter::toDb(levels.peakOut[0]), DynamicsMeter::toDb(levels.rmsOut[0]),
+           DynamicsMeter::toDb(levels.minGain[0]), DynamicsMeter::toDb(levels.meanGain[0]));
+  }
+
+  if (argc == 3 && !writeWav(argv[2], output, sampleRate)) return 1;
+
+  return 0;
+}
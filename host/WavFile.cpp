@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "WavFile.h"
+
+#define WAVE_FORMAT_PCM 1
+#define WAVE_FORMAT_IEEE_FLOAT 3
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+static uint32_t readLe(const uint8_t *p, int bytes) {
+  uint32_t v = 0;
+  for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | p[i];
+  return v;
+}
+
+static void writeLe(FILE *f, uint32_t v, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    fputc(v & 0xFF, f);
+    v >>= 8;
+  }
+}
+
+static int16_t clip16(float f) {
+  if (f > 32767.0f) return 32767;
+  if (f < -32768.0f) return -32768;
+  return (int16_t)f;
+}
+
+bool readWav(const char *path, std::vector<int16_t> &samples, float &sampleRate) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return false;
+  }
+
+  uint8_t header[12];
+  if (fread(header, 1, 12, f) != 12 || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+    fprintf(stderr, "%s: not a RIFF/WAVE file\n", path);
+    fclose(f);
+    return false;
+  }
+
+  int format = 0, channels = 0, bits = 0;
+  bool haveFormat = false;
+  sampleRate = 0;
+
+  uint8_t chunk[8];
+  while (fread(chunk, 1, 8, f) == 8) {
+    uint32_t size = readLe(chunk + 4, 4);
+
+    if (memcmp(chunk, "fmt ", 4) == 0) {
+      std::vector<uint8_t> fmt(size);
+      if (size < 16 || fread(fmt.data(), 1, size, f) != size) break;
+      format = readLe(&fmt[0], 2);
+      channels = readLe(&fmt[2], 2);
+      sampleRate = (float)readLe(&fmt[4], 4);
+      bits = readLe(&fmt[14], 2);
+      if (format == WAVE_FORMAT_EXTENSIBLE && size >= 26) format = readLe(&fmt[24], 2);
+      haveFormat = true;
+      if (size & 1) fgetc(f);
+
+    } else if (memcmp(chunk, "data", 4) == 0 && haveFormat) {
+      bool pcm = format == WAVE_FORMAT_PCM && (bits == 16 || bits == 24);
+      bool flt = format == WAVE_FORMAT_IEEE_FLOAT && bits == 32;
+      if (!(pcm || flt) || channels < 1) {
+        fprintf(stderr, "%s: unsupported format %d, %d bits\n", path, format, bits);
+        fclose(f);
+        return false;
+      }
+
+      int frameBytes = channels * bits / 8;
+      size_t frames = size / frameBytes;
+      std::vector<uint8_t> data(frames * frameBytes);
+      frames = fread(data.data(), frameBytes, frames, f);
+
+      // keep the first channel only
+      samples.resize(frames);
+      for (size_t i = 0; i < frames; ++i) {
+        const uint8_t *p = &data[i * frameBytes];
+        if (bits == 16) {
+          samples[i] = (int16_t)readLe(p, 2);
+        } else if (bits == 24) {
+          samples[i] = (int16_t)(readLe(p, 3) >> 8);
+        } else {
+          uint32_t u = readLe(p, 4);
+          float v;
+          memcpy(&v, &u, sizeof(v));
+          samples[i] = clip16(v * 32768.0f);
+        }
+      }
+      fclose(f);
+      return true;
+
+    } else {
+      fseek(f, size + (size & 1), SEEK_CUR);
+    }
+  }
+
+  fprintf(stderr, "%s: no audio data found\n", path);
+  fclose(f);
+  return false;
+}
+
+bool writeWav(const char *path, const std::vector<int16_t> &samples, float sampleRate) {
+  FILE *f = fopen(path, "wb");
+  if (f == NULL) {
+    fprintf(stderr, "%s: cannot create\n", path);
+    return false;
+  }
+
+  uint32_t dataBytes = samples.size() * 2;
+  uint32_t rate = (uint32_t)(sampleRate + 0.5f);
+
+  fwrite("RIFF", 1, 4, f);
+  writeLe(f, 36 + dataBytes, 4);
+  fwrite("WAVE", 1, 4, f);
+
+  fwrite("fmt ", 1, 4, f);
+  writeLe(f, 16, 4);
+  writeLe(f, WAVE_FORMAT_PCM, 2);
+  writeLe(f, 1, 2);
+  writeLe(f, rate, 4);
+  writeLe(f, rate * 2, 4);
+  writeLe(f, 2, 2);
+  writeLe(f, 16, 2);
+
+  fwrite("data", 1, 4, f);
+  writeLe(f, dataBytes, 4);
+  for (size_t i = 0; i < samples.size(); ++i) writeLe(f, (uint16_t)samples[i], 2);
+
+  bool ok = ferror(f) == 0;
+  fclose(f);
+  return ok;
+}
@@ -0,0 +1,16 @@
+#ifndef _HOST_WAV_FILE_H
+#define _HOST_WAV_FILE_H
+
+#include <stdint.h>
+#include <vector>
+
+/*
+   Just enough RIFF/WAVE handling for the offline renderer.
+   Reads 16 and 24 bit PCM and 32 bit float, keeping only the first channel (the Teensy patch only uses the left input).
+   Writes 16 bit mono PCM.
+*/
+
+bool readWav(const char *path, std::vector<int16_t> &samples, float &sampleRate);
+bool writeWav(const char *path, const std::vector<int16_t> &samples, float sampleRate);
+
+#endif /* _HOST_WAV_FILE_H */